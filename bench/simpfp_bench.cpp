@@ -0,0 +1,339 @@
+/**
+ * Benchmarks of simpfp directory model on synthetic directories.
+ *
+ * Fixtures are generated once per size and seed under the temp directory and reused by later runs.
+ * Every measured operation is reported as a single line of JSON on stdout, progress goes to stderr.
+ *
+ *   simpfp_bench [--sizes 10000,100000,1000000] [--reps 7] [--seed 1] [--dir <path>] [--clean]
+ */
+
+#include <simpfp_core.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+    namespace fs = std::filesystem;
+
+    using clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::vector<std::size_t> sizes = { 10000, 100000, 1000000 };
+        int                      reps  = 7;
+        std::uint32_t            seed  = 1;
+        fs::path                 dir   = fs::temp_directory_path() / "simpfp_bench";
+        bool                     clean = false;
+    };
+
+    /**
+     * @return peak resident set size of the process in KiB, 0 if unknown
+     */
+    inline long peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    inline double elapsed_ms(const clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(clock::now() - since).count();
+    }
+
+    /**
+     * Nearest-rank percentile of sorted samples.
+     */
+    inline double percentile(const std::vector<double> &sorted, const double p) {
+        if (sorted.empty())
+            return 0;
+        const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    inline void json_string(const char *str) {
+        std::putchar('"');
+        for (const char *c = str; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\')
+                std::putchar('\\');
+            std::putchar(*c);
+        }
+        std::putchar('"');
+    }
+
+    /**
+     * Prints one result line: {"fixture":..,"entries":..,"op":..,"reps":..,"items":..,"min_ms":..,
+     * "p50_ms":..,"p99_ms":..,"max_ms":..,"items_per_s":..,"peak_rss_kb":..}
+     */
+    inline void report(const std::string &fixture, const std::size_t entries, const std::string &op,
+                       std::vector<double> samples, const std::size_t items) {
+        std::sort(samples.begin(), samples.end());
+        const double p50 = percentile(samples, 50);
+
+        std::printf("{\"fixture\":");
+        json_string(fixture.c_str());
+        std::printf(",\"entries\":%zu,\"op\":", entries);
+        json_string(op.c_str());
+        std::printf(",\"reps\":%zu,\"items\":%zu,\"min_ms\":%.4f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,"
+                    "\"items_per_s\":%.0f,\"peak_rss_kb\":%ld}\n",
+                    samples.size(), items, samples.front(), p50, percentile(samples, 99), samples.back(),
+                    p50 > 0 ? static_cast<double>(items) / (p50 / 1000.0) : 0.0, peak_rss_kb());
+        std::fflush(stdout);
+    }
+
+    /**
+     * Runs <b>prepare</b> untimed and <b>run</b> timed, <b>reps</b> times.
+     */
+    template <typename Prepare, typename Run>
+    std::vector<double> measure(const int reps, Prepare &&prepare, Run &&run) {
+        std::vector<double> samples;
+        for (int i = 0; i < reps; i++) {
+            prepare();
+            const auto start = clock::now();
+            run();
+            samples.push_back(elapsed_ms(start));
+        }
+        return samples;
+    }
+
+    /**
+     * Fills <b>dir</b> with <b>count</b> files: long names of varying length, mixed extensions,
+     * sparse sizes, ~1% unreadable files, ~1% symlinks (some dangling) and a few subdirectories.
+     * Same size and seed always produce the same tree.
+     */
+    inline void generate(const fs::path &dir, const std::size_t count, const std::uint32_t seed) {
+        static const char *words[] = { "report", "img",     "IMG",  "backup", "data",    "final", "draft",
+                                       "Photo",  "invoice", "log",  "track",  "archive", "notes", "scan" };
+        static const char *exts[]  = { ".txt", ".png", ".jpg", ".cpp", ".h",    ".md",  ".tar.gz",
+                                       ".JSON", ".csv", "",     ".log", ".webp", ".pdf", ".hpp" };
+
+        std::mt19937                                 gen(seed ^ static_cast<std::uint32_t>(count));
+        std::uniform_int_distribution<std::size_t>   word(0, std::size(words) - 1);
+        std::uniform_int_distribution<std::size_t>   ext(0, std::size(exts) - 1);
+        std::uniform_int_distribution<int>           pad(0, 96);
+        std::uniform_int_distribution<int>           percent(0, 999);
+        std::uniform_int_distribution<std::uint64_t> size(0, 1ull << 30);
+
+        fs::create_directories(dir);
+
+        const std::size_t dirs = std::max<std::size_t>(8, count / 1000);
+        for (std::size_t i = 0; i < dirs; i++)
+            fs::create_directory(dir / ("dir_" + std::to_string(i)));
+
+        std::string name;
+        std::string last;
+        for (std::size_t i = 0; i < count; i++) {
+            name.assign(words[word(gen)]).append("_").append(std::to_string(i));
+            for (int k = pad(gen); k > 0; k--)
+                name.push_back(static_cast<char>('a' + (k * 7 + i) % 26));
+            name.append(exts[ext(gen)]);
+
+            const auto path = dir / name;
+            const int  kind = percent(gen);
+
+            if (kind < 10 && !last.empty()) {
+                std::error_code ec;
+                fs::create_symlink(kind < 2 ? dir / "missing" : dir / last, path, ec);
+                continue;
+            }
+
+#if defined(__unix__) || defined(__APPLE__)
+            const int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, kind < 20 ? 0000 : 0644);
+            if (fd >= 0) {
+                [[maybe_unused]] const int r = ::ftruncate(fd, static_cast<off_t>(size(gen)));
+                ::close(fd);
+            }
+#else
+            std::ofstream(path).put('x');
+#endif
+            last = name;
+        }
+    }
+
+    /**
+     * @return fixture directory for given size, generated if it does not exist yet
+     */
+    inline fs::path fixture(const Options &options, const std::size_t count) {
+        const auto dir    = options.dir / (std::to_string(count) + "-" + std::to_string(options.seed));
+        const auto marker = dir / ".simpfp_bench";
+
+        if (options.clean)
+            fs::remove_all(dir);
+        if (fs::exists(marker))
+            return dir;
+
+        std::fprintf(stderr, "generating %zu files in %s\n", count, dir.string().c_str());
+        const auto start = clock::now();
+        fs::remove_all(dir);
+        generate(dir, count, options.seed);
+        std::ofstream(marker) << count << ' ' << options.seed << '\n';
+        std::fprintf(stderr, "generated in %.0f ms\n", elapsed_ms(start));
+        return dir;
+    }
+
+    inline void run(const Options &options, const std::size_t count) {
+        const auto dir  = fixture(options, count);
+        const auto name = "flat-" + std::to_string(count);
+        const int  reps = options.reps;
+
+        static const char *filters[] = { "*", "*.txt", "*.{png,jpg,webp}", "img_??*;*.h;*.hpp", "*.tar.gz", nullptr };
+
+        simpfp::DirectoryModel model(filters);
+
+        // every load has to hit the disk, and none of them competes with background prefetch of the parent
+        simpfp::ListingCacheCapacity(0, 0);
+        model.PrefetchListings(false);
+
+        {
+            std::vector<double> first;
+            const auto          samples = measure(reps, [] {}, [&] {
+                const auto start      = clock::now();
+                bool       seen_first = false;
+                model.Open(dir.string().c_str());
+                while (model.Loading()) {
+                    model.Update();
+                    if (!seen_first && model.FileCount() > 0) {
+                        first.push_back(elapsed_ms(start));
+                        seen_first = true;
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            });
+            const auto entries = model.DirCount() + model.FileCount();
+            report(name, entries, "load", samples, entries);
+            if (!first.empty())
+                report(name, entries, "load.first_rows", first, simpfp::internal_::LoadJob::first_batch);
+        }
+
+        const std::size_t files   = model.FileCount();
+        const std::size_t entries = model.DirCount() + files;
+
+        static const char *columns[] = { "name", "size", "type", "date" };
+        for (const bool natural : { false, true }) {
+            model.NaturalSort(natural);
+            for (int by = SORT_NAME; by <= SORT_TIME; by++) {
+                for (int order = SORT_ASC; order <= SORT_DSC; order++) {
+                    // back to directory order, so that every sort starts from the same permutation
+                    const auto samples = measure(reps, [&] { model.Sort(SORT_NONE); }, [&] { model.Sort(by, order); });
+                    report(name, entries,
+                           std::string("sort.") + (natural ? "natural." : "") + columns[by - 1] + (order == SORT_ASC ? ".asc" : ".desc"),
+                           samples, files);
+                }
+            }
+        }
+        model.NaturalSort(false);
+        model.Sort(SORT_NAME, SORT_ASC);
+
+        for (int i = 1; filters[i] != nullptr; i++) {
+            const auto samples = measure(reps, [&] { model.Filter(0); }, [&] { model.Filter(i); });
+            report(name, entries, std::string("filter.") + filters[i], samples, entries);
+        }
+        model.Filter(0);
+
+        for (const char *query : { "r", "rep", "report_1", "zzq" }) {
+            const auto samples = measure(reps, [&] { model.Search(nullptr); }, [&] { model.Search(query); });
+            report(name, entries, std::string("search.") + query, samples, files);
+        }
+        model.Search(nullptr);
+
+        const auto unselect = [&] { model.UnselectAll(); };
+        const auto select   = [&] { model.SelectAll(); };
+
+        report(name, entries, "select.all", measure(reps, unselect, select), files);
+        report(name, entries, "select.invert", measure(reps, select, [&] { model.InvertSelection(); }), files);
+        report(name, entries, "select.none", measure(reps, select, unselect), files);
+        report(name, entries, "select.range", measure(reps, unselect, [&] {
+            model.Select(0);
+            model.SelectRange(files - 1);
+        }), files);
+        report(name, entries, "select.matching", measure(reps, unselect, [&] { model.SelectMatching("*.png"); }), files);
+
+        constexpr std::size_t clicks = 1000;
+        report(name, entries, "select.toggle", measure(reps, unselect, [&] {
+            for (std::size_t i = 0; i < clicks && i < files; i++)
+                model.Toggle(i * 7919 % files);
+        }), clicks);
+
+        std::size_t bytes = 0;
+        report(name, entries, "extract.for_each", measure(reps, select, [&] {
+            bytes = 0;
+            model.ForEachSelected([&](const char *path) {
+                bytes += std::strlen(path);
+                return true;
+            });
+        }), files);
+
+        report(name, entries, "extract.batch", measure(reps, select, [&] {
+            bytes = 0;
+            for (const auto path : model.Selected())
+                bytes += path.size();
+        }), files);
+    }
+
+    inline bool parse(const int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg  = argv[i];
+            const char       *next = i + 1 < argc ? argv[i + 1] : nullptr;
+
+            if (arg == "--clean") {
+                options.clean = true;
+                continue;
+            }
+            if (next == nullptr)
+                return false;
+            i++;
+
+            if (arg == "--sizes") {
+                options.sizes.clear();
+                for (const char *c = next; *c != '\0';) {
+                    char *end = nullptr;
+                    options.sizes.push_back(std::strtoull(c, &end, 10));
+                    c = *end == ',' ? end + 1 : end;
+                    if (end == c && *c != '\0')
+                        return false;
+                }
+            }
+            else if (arg == "--reps")
+                options.reps = std::max(1, std::atoi(next));
+            else if (arg == "--seed")
+                options.seed = static_cast<std::uint32_t>(std::strtoul(next, nullptr, 10));
+            else if (arg == "--dir")
+                options.dir = next;
+            else
+                return false;
+        }
+        return true;
+    }
+
+} // namespace bench
+
+int main(const int argc, char **argv) {
+    bench::Options options;
+    if (!bench::parse(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--sizes 10000,100000,1000000] [--reps 7] [--seed 1] [--dir <path>] [--clean]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    for (const auto count : options.sizes)
+        bench::run(options, count);
+    return 0;
+}
@@ -6,14 +6,7 @@
 #ifndef SIMPFP_H
 #define SIMPFP_H
 
-#include <algorithm>
-#include <chrono>
-#include <cstring>
-#include <filesystem>
-#include <fstream>
-#include <regex>
-#include <random>
-#include <string.h>
+#include "simpfp_core.h"
 
 namespace simpfp {
 
@@ -25,12 +18,18 @@ namespace simpfp {
         const char *dir_input   = "Enter a new folder name:";
         const char *dir_accept  = "OK";
         const char *dir_cancel  = "Cancel";
+        const char *main_hidden = "Hidden files";
+        const char *loading     = "Loading...";
+        const char *selected    = "files selected";
+        const char *search      = "Search";
+        const char *main_tree   = "Recursive";
+        const char *no_preview  = "No preview";
     };
 
     /**
      * @param title title of the file picker window
      * @param default_path can be path to a directory or a file
-     * @param filters array of glob-style strings, ie: *.cpp / *.txt / *.md / etc.
+     * @param filters array of glob-style strings, ie: *.cpp / *.txt / *.{md,rst} / *.cpp;*.h / etc.
      * <br/><b>Must be terminated with nullptr!</b>
      * @param labels custom labels
      * @param read_only require only read permission
@@ -51,1443 +50,1623 @@ namespace simpfp {
 
     bool FilterSelected(int *filter_idx);
 
+    /**
+     * Streams absolute paths of all accepted files, no matter how many of them were selected.
+     * @param callback receives every path (valid only during the call), returning false stops iteration
+     * @return number of reported paths, 0 if nothing was accepted since last call
+     */
+    std::size_t ForEachAccepted(const std::function<bool(const char *path)> &callback);
+
+    /**
+     * Same as ForEachAccepted(), but reports current selection at any time.
+     */
+    std::size_t ForEachSelected(const std::function<bool(const char *path)> &callback);
+
+    /**
+     * All accepted paths in one call, consumes acceptance just like FileAccepted().
+     * Paths are absolute, built without touching the filesystem.
+     * @return view valid until next call (at least until next frame), empty if nothing was accepted since last call
+     */
+    PathSpan AcceptedPaths();
+
+    /**
+     * Same as AcceptedPaths(), but returns current selection at any time.
+     */
+    PathSpan SelectedPaths();
+
+    /**
+     * Callbacks run at the end of the frame in which the event happened, after the dialog's popup is closed.
+     * Paths given to them are valid only during the call. Pass nullptr to unsubscribe.
+     */
+    void OnSelectionChanged(std::function<void(PathSpan paths)> callback);
+    void OnFileAccepted(std::function<void(PathSpan paths)> callback);
+    void OnDirectoryChanged(std::function<void(const char *path)> callback);
+
+    /**
+     * @param enable match filters case-insensitively (ASCII), ie: *.txt also matches README.TXT
+     */
+    void FilterIgnoreCase(bool enable);
+
+    /**
+     * @param enable list entries starting with '.'
+     */
+    void ShowHiddenFiles(bool enable);
+
     const char *CurrentPath();
 
     bool FileDialogOpen();
     void CloseFileDialog();
     void EndFileDialog();
 
-    long CountSelected();
-    void UnselectAll();
-    void ResetBuffer();
-    void Reload();
+    /**
+     * @param enable show file sizes in binary units (KiB, MiB, ...) instead of raw bytes
+     */
+    void HumanReadableSize(bool enable);
 
-    namespace internal_ {
-        namespace fs = std::filesystem;
-
-#define SORT_NONE 0
-
-#define SORT_NAME 1
-#define SORT_SIZE 2
-#define SORT_TYPE 3
-#define SORT_TIME 4
-
-#define SORT_ASC 1
-#define SORT_DSC 2
-
-        inline const char *title        = nullptr;
-        inline const char *file_path    = nullptr;
-        inline bool       *open_ptr     = nullptr;
-        inline bool        reset        = false;
-        inline bool        closed       = true;
-        inline bool        resizable    = true;
-        inline bool        single       = true;
-        inline bool        accept_empty = false;
-        inline bool        dir_only     = false;
-        inline bool        read_only    = false;
-
-        inline const char **filters = nullptr;
-        inline Labels       labels;
-
-        inline void reset_vars() {
-            internal_::open_ptr     = nullptr;
-            internal_::filters      = nullptr;
-            internal_::title        = nullptr;
-            internal_::reset        = false;
-            internal_::closed       = true;
-            internal_::resizable    = true;
-            internal_::single       = true;
-            internal_::accept_empty = false;
-            internal_::dir_only     = false;
-            internal_::read_only    = false;
-            internal_::labels       = Labels();
-        }
+    /**
+     * @param enable sort names naturally and case-insensitively (ASCII), ie: file2 before File10
+     */
+    void NaturalSort(bool enable);
 
-        inline std::string glob_to_regex(const char *glob) {
-            std::string regex_pattern = glob;
-            for (size_t pos = 0; (pos = regex_pattern.find('.', pos)) != std::string::npos; ++pos) {
-                regex_pattern.replace(pos, 1, "\\.");
-                pos++;
-            }
-            for (size_t pos = 0; (pos = regex_pattern.find('*', pos)) != std::string::npos; ++pos) {
-                regex_pattern.replace(pos, 1, ".*");
-                pos += 1;
-            }
-            return regex_pattern;
-        }
+    /**
+     * @param enable keep current directory up to date as entries are created, removed or modified,
+     * instead of requiring Reload() (inotify, linux only)
+     */
+    void WatchDirectory(bool enable);
 
-        inline fs::path generate_temp_file(const fs::path& directory) {
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<uint64_t> dist(100000, 999999);
-            const auto timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
-            const auto filename = ".perm_check_" + std::to_string(timestamp) + "_" + std::to_string(dist(gen)) + ".tmp";
-            return directory / filename;
-        }
+    /**
+     * Lists all files of the subtree, named relative to current directory, scanned in parallel.
+     * Filters are applied while walking, so changing them walks the tree again.
+     * @param enable flatten subtree of current directory into the files table
+     * @param max_depth how deep to descend, 0 lists only current directory
+     */
+    void RecursiveListing(bool enable, int max_depth = 32);
 
-        inline bool can_write(const fs::path &path) {
-            std::error_code ec;
-            const auto      perms = std::filesystem::status(path, ec).permissions();
+    /**
+     * @return timings and counters of the last load and frame, all zero unless compiled with SIMPFP_STATS
+     */
+    PhaseStats FileDialogStats();
 
-            if (ec)
-                return false;
+    /**
+     * @param enable draw timings and counters over the dialog, does nothing unless compiled with SIMPFP_STATS
+     */
+    void ShowStatsOverlay(bool enable);
 
-            if (fs::is_directory(path)) {
-                fs::path temp_file = generate_temp_file(path);
-                std::ofstream file(temp_file);
-                if (!file.is_open())
-                    return false;
-                file.close();
-                fs::remove(temp_file, ec);
-                return true;
-            }
+    /**
+     * Shows head of the focused or last selected file next to the files table: text as is, anything else
+     * as hex dump. Previews are rendered in background and recently viewed ones are kept in memory.
+     * @param enable show preview pane
+     */
+    void ShowPreviewPane(bool enable);
 
-            if ((perms & std::filesystem::perms::owner_write) != std::filesystem::perms::none ||
-                  (perms & std::filesystem::perms::group_write) != std::filesystem::perms::none ||
-                  (perms & std::filesystem::perms::others_write) != std::filesystem::perms::none) {
-                return true;
-            }
+    /**
+     * Computes recursive size, file count and latest change of every listed directory on an idle
+     * background worker and shows them next to directory names as they arrive.
+     * Totals are cached by directory identity, entering another directory cancels the computation.
+     * @param enable compute directory totals
+     */
+    void DirectorySizes(bool enable);
 
-            std::ofstream file(path, std::ios::app);
-            return file.is_open();
-        }
+    /**
+     * Enumerates hovered or focused directories and the parent of current one in background,
+     * so that entering them shows a ready listing. Enabled by default.
+     * @param enable prefetch listings of directories likely to be entered next
+     */
+    void PrefetchListings(bool enable);
 
-        inline bool can_read(const fs::path &path) {
-            std::error_code ec;
-            const auto      perms = std::filesystem::status(path, ec).permissions();
+    long CountSelected();
+    void UnselectAll();
+    void SelectAll();
+    void InvertSelection();
 
-            if (ec)
-                return false;
+    /**
+     * Replaces selection with all visible files matching given glob, ie: *.png / img_??.{jpg,png}
+     * @return number of selected files
+     */
+    long SelectMatching(const char *glob);
+    void ResetBuffer();
+    void Reload();
 
-            if ((perms & std::filesystem::perms::owner_read) != std::filesystem::perms::none ||
-                (perms & std::filesystem::perms::group_read) != std::filesystem::perms::none ||
-                (perms & std::filesystem::perms::others_read) != std::filesystem::perms::none) {
-                const std::ifstream file(path);
-                return file.good();
-            }
+    /**
+     * Narrows files table down to names fuzzy-matching given query (on top of active filter),
+     * best matches first. Empty query or nullptr ends the search.
+     */
+    void Search(const char *query);
+
+    /**
+     * File picker dialog. Any number of instances can coexist, each with its own directory, selection
+     * and settings, shown in any window of any ImGui context. All instances share one listing cache
+     * and worker pool, so keeping several pickers warm costs no extra threads.
+     * <br/>Free functions above drive a default instance.
+     * <br/>Not thread-safe: all dialogs and DirectoryModel instances have to be driven from the same thread.
+     */
+    class FileDialog {
+    public:
+        FileDialog() = default;
 
-            return false;
+        ~FileDialog() {
+            delete context;
         }
 
-        inline char *cpy_str(const char *str) {
-            if (str == nullptr)
-                return nullptr;
-            const auto len  = std::strlen(str);
-            auto      *buff = new char[len + 1];
-            std::strcpy(buff, str);
-            return buff;
+        FileDialog(const FileDialog &)            = delete;
+        FileDialog &operator=(const FileDialog &) = delete;
+
+        /**
+         * Same parameters as OpenFileDialog(), drops listing of previously opened directory.
+         */
+        void Open(const char *title, const char *default_path = nullptr, const char **filters = nullptr,
+                  const Labels *labels = nullptr, const bool read_only = false, const bool accept_empty = false,
+                  const bool dir_only = false) {
+            this->open_ptr     = nullptr;
+            this->closed       = false;
+            this->single       = true;
+            this->reset        = true;
+            this->title        = title;
+            this->dir_only     = dir_only;
+            this->file_path    = default_path;
+            this->accept_empty = accept_empty || dir_only;
+            settings.filters   = filters;
+            settings.read_only = read_only;
+
+            settings.compile_filters();
+
+            if (labels != nullptr) {
+                this->labels      = *labels;
+                settings.selected = this->labels.selected;
+            }
+            if (context != nullptr) {
+                delete context;
+                context = nullptr;
+            }
         }
 
-        inline void cat_str(char *dst, const char *src, const std::size_t dst_size) {
-            const std::size_t free_len = dst_size - std::strlen(dst);
-            const std::size_t src_len  = std::strlen(src);
-            const std::size_t lim_len  = std::min(src_len, free_len);
-            std::strncat(dst, src, lim_len);
+        bool IsOpen() const {
+            return !closed;
         }
 
-        inline fs::path load_path(const char *file) {
-            if (file == nullptr)
-                return fs::current_path();
-            const auto path = fs::path(file);
-            return fs::exists(path) ? path : fs::current_path();
+        void Close() {
+            if (open_ptr != nullptr)
+                *open_ptr = false;
+            closed = true;
+            if (context != nullptr) {
+                delete context;
+                context = nullptr;
+            }
         }
 
-        inline char *format_time(const fs::file_time_type &ftime) {
-            const auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                    ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-            const auto tt  = std::chrono::system_clock::to_time_t(sctp);
-            const auto gmt = std::localtime(&tt);
-            char       buffer[20];
-            std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", gmt);
-            return cpy_str(buffer);
+        bool Show(const char *label, bool *open = nullptr) {
+            return show_dialog(label, open);
         }
 
-        inline std::size_t get_unix_timestamp_ms(const fs::file_time_type &ftime) {
-            const auto sctp = std::chrono::time_point_cast<std::chrono::milliseconds>(
-                    ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-            return static_cast<std::size_t>(sctp.time_since_epoch().count());
+        bool Show(const char *label, bool *open, const ImVec2 &size, const bool resize = true) {
+            return show_dialog(label, open, &size, resize);
         }
 
-        struct FileInfo {
-            const fs::path *path     = nullptr;
-            const char     *name     = nullptr;
-            const char     *type     = nullptr;
-            const char     *time     = nullptr;
-            std::size_t     size     = 0;
-            std::size_t     date     = 0;
-            int             index    = 0;
-            bool            read     = false;
-            bool            write    = false;
-            bool            selected = false;
-
-            FileInfo() = default;
-
-            FileInfo(const FileInfo &other) {
-                path     = other.path != nullptr ? (new fs::path(*other.path)) : nullptr;
-                name     = cpy_str(other.name);
-                type     = cpy_str(other.type);
-                time     = cpy_str(other.time);
-                read     = other.read;
-                write    = other.write;
-                selected = other.selected;
-                size     = other.size;
-                date     = other.date;
+        void End() {
+            if (closed) {
+                if (open_ptr != nullptr)
+                    *open_ptr = false;
+                if (context != nullptr) {
+                    delete context;
+                    context = nullptr;
+                }
+                ImGui::EndPopup();
+                return;
             }
 
-            FileInfo(FileInfo &&other) noexcept {
-                path     = other.path;
-                name     = other.name;
-                type     = other.type;
-                time     = other.time;
-                size     = other.size;
-                date     = other.date;
-                read     = other.read;
-                write    = other.write;
-                selected = other.selected;
-
-                other.path = nullptr;
-                other.name = nullptr;
-                other.type = nullptr;
-                other.time = nullptr;
+            if (open_ptr != nullptr && !*open_ptr) {
+                closed = true;
+                if (context != nullptr) {
+                    delete context;
+                    context = nullptr;
+                }
+                ImGui::EndPopup();
+                return;
             }
 
-            FileInfo &operator=(FileInfo &&other) noexcept {
-                if (&other == this)
-                    return *this;
-
-                if (name != nullptr && other.name != name)
-                    delete[] name;
-                if (type != nullptr && other.type != type)
-                    delete[] type;
-                if (time != nullptr && other.time != time)
-                    delete[] time;
-                if (path != nullptr && other.path != path)
-                    delete path;
-
-                path     = other.path;
-                name     = other.name;
-                type     = other.type;
-                time     = other.time;
-                size     = other.size;
-                date     = other.date;
-                read     = other.read;
-                write    = other.write;
-                selected = other.selected;
-
-                other.path = nullptr;
-                other.name = nullptr;
-                other.type = nullptr;
-                other.time = nullptr;
-
-                return *this;
+            if (context == nullptr) {
+                internal_::FileContext::load(&context, file_path, &settings);
+                if (settings.filters != nullptr) {
+                    context->filter_idx = 0;
+                }
             }
 
-            FileInfo &operator=(const FileInfo &other) {
-                if (&other == this)
-                    return *this;
-
-                if (name != nullptr && other.name != name)
-                    delete[] name;
-                if (type != nullptr && other.type != type)
-                    delete[] type;
-                if (time != nullptr && other.time != time)
-                    delete[] time;
-                if (path != nullptr && other.path != path)
-                    delete path;
-
-                path     = other.path != nullptr ? (new fs::path(*other.path)) : nullptr;
-                name     = cpy_str(other.name);
-                type     = cpy_str(other.type);
-                time     = cpy_str(other.time);
-                selected = other.selected;
-                read     = other.read;
-                write    = other.write;
-                size     = other.size;
-                date     = other.date;
-
-                return *this;
+            SIMPFP_STAT(const auto frame_started = std::chrono::steady_clock::now(); std::uint64_t rows = 0;
+                        context->cells.format_ns = 0;
+                        context->cells.formatted = 0;)
+            {
+                SIMPFP_STAT(const internal_::StatTimer timer(context->stats.poll_ns);)
+                internal_::FileContext::poll(context);
             }
 
-            ~FileInfo() {
-                if (name != nullptr)
-                    delete[] name;
-                if (type != nullptr)
-                    delete[] type;
-                if (time != nullptr)
-                    delete[] time;
-                if (path != nullptr)
-                    delete path;
+            const float reserve_y = (ImGui::GetFrameHeight() * 4) + ImGui::GetStyle().ItemSpacing.y;
+
+            constexpr float ratio     = 0.25f;
+            const float     spacing_x = ImGui::GetStyle().ItemSpacing.x;
+            const float     free_x    = ImGui::GetContentRegionAvail().x - spacing_x;
+
+            constexpr float preview_ratio = 0.4f;
+
+            const float free_x_uno = free_x * ratio;
+            const float free_x_des = free_x * (1.f - ratio) * (show_preview ? 1.f - preview_ratio : 1.f);
+            const float free_x_pre = free_x * (1.f - ratio) * preview_ratio - spacing_x;
+
+            const bool key_shift = ImGui::IsKeyPressed(ImGuiKey_LeftShift) || ImGui::IsKeyDown(ImGuiKey_LeftShift);
+            const bool key_ctrl  = ImGui::IsKeyPressed(ImGuiKey_LeftCtrl) || ImGui::IsKeyDown(ImGuiKey_LeftCtrl);
+
+            // only the focused dialog reacts, others may be open at the same time
+            if ((ImGui::IsKeyPressed(ImGuiKey_Escape) || ImGui::IsKeyDown(ImGuiKey_Escape)) &&
+                ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+                if (open_ptr != nullptr)
+                    *open_ptr = false;
+                closed    = true;
+                ImGui::CloseCurrentPopup();
+                ImGui::EndPopup();
+                if (context != nullptr) {
+                    delete context;
+                    context = nullptr;
+                }
+                return;
             }
-        };
 
-        struct FileContext {
-            static constexpr std::size_t buffer_size = 256;
-            char                        *buffer      = new char[buffer_size]{};
-
-            const fs::path *path     = nullptr;
-            FileInfo       *dirs     = nullptr;
-            FileInfo       *files    = nullptr;
-            FileInfo      **selected = nullptr;
-
-            int selected_num = 0;
-            int files_num    = 0;
-            int dirs_num     = 0;
-            int filter_idx   = 0;
-
-            char sort_by   = SORT_NONE;
-            char sort_type = SORT_NONE;
-
-            bool accepted = false;
-            bool peeked   = true;
-
-            bool read  = false;
-            bool write = false;
-
-            ~FileContext() {
-                if (selected != nullptr)
-                    delete[] selected;
-                if (files != nullptr)
-                    delete[] files;
-                if (dirs != nullptr)
-                    delete[] dirs;
-                if (path != nullptr)
-                    delete path;
-                if (buffer != nullptr)
-                    delete[] buffer;
+            ImGui::Spacing();
+            ImGui::Text("%s", context->path->c_str());
+            if (internal_::FileContext::loading(context)) {
+                static constexpr char spinner[] = { '|', '/', '-', '\\' };
+                ImGui::SameLine();
+                ImGui::TextDisabled("%s %c %d", labels.loading,
+                                    spinner[static_cast<int>(ImGui::GetTime() * 8.0) % 4],
+                                    internal_::FileContext::files_num(context));
             }
 
-            static void permissions(const fs::file_status &status, FileInfo &file) {
-                const auto perms = status.permissions();
-                file.read        = (perms & fs::perms::owner_read) != fs::perms::none ||
-                            (perms & fs::perms::group_read) != fs::perms::none ||
-                            (perms & fs::perms::others_read) != fs::perms::none;
+            {
+                // type-ahead: typing anywhere in the dialog outside of text inputs goes to the search field
+                auto           &io       = ImGui::GetIO();
+                char           *search   = context->search_buffer;
+                std::size_t     length   = std::strlen(search);
+                constexpr float search_w = 200.f;
+                bool            focus    = key_ctrl && ImGui::IsKeyPressed(ImGuiKey_F);
+
+                if (!io.WantTextInput && !key_ctrl && ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+                    const auto before = length;
+                    for (int i = 0; i < io.InputQueueCharacters.Size; i++) {
+                        const auto c = io.InputQueueCharacters[i];
+                        if (c >= 32 && c < 127 && length + 1 < internal_::FileContext::search_size)
+                            search[length++] = static_cast<char>(c);
+                    }
+                    if (ImGui::IsKeyPressed(ImGuiKey_Backspace) && length > 0)
+                        search[--length] = '\0';
+                    if (length != before)
+                        internal_::FileContext::search(context, search);
+                }
 
-                file.write = (perms & fs::perms::owner_write) != fs::perms::none ||
-                             (perms & fs::perms::group_write) != fs::perms::none ||
-                             (perms & fs::perms::others_write) != fs::perms::none;
+                ImGui::SameLine(ImGui::GetWindowWidth() - search_w - ImGui::CalcTextSize("*").x -
+                                ImGui::GetStyle().FramePadding.x - ImGui::GetStyle().ItemSpacing.x * 2);
+                if (focus)
+                    ImGui::SetKeyboardFocusHere();
+                ImGui::SetNextItemWidth(search_w);
+                if (ImGui::InputTextWithHint("##search", labels.search, search,
+                                             internal_::FileContext::search_size))
+                    internal_::FileContext::search(context, search);
             }
 
-            static void load(FileContext **context, const char *path) {
-                const auto og_f = load_path(path);
-                const auto file = new fs::path(fs::is_directory(og_f) ? og_f : og_f.parent_path());
+            ImGui::SameLine(ImGui::GetWindowWidth() - ImGui::CalcTextSize("*").x - ImGui::GetStyle().FramePadding.x -
+                            ImGui::GetStyle().ItemSpacing.x);
+            ImGui::TextDisabled("%s", (key_shift || key_ctrl) ? "*" : "");
+
+            ImGui::BeginChild("##region_dirs", ImVec2(free_x_uno, -reserve_y), ImGuiChildFlags_Borders);
+
+            int open_dir = -1;
 
-                char sort_by   = SORT_NONE;
-                char sort_type = SORT_NONE;
+            ImGuiListClipper dirs_clipper;
+            dirs_clipper.Begin(internal_::FileContext::dirs_num(context));
+            while (dirs_clipper.Step()) {
+                for (int i = dirs_clipper.DisplayStart; i < dirs_clipper.DisplayEnd; i++) {
+                    const auto id       = context->dirs[i];
+                    const bool read     = context->listing.is(id, ENTRY_READ);
+                    bool       selected = false;
+                    SIMPFP_STAT(rows++;)
 
-                int filter = 0;
+                    ImGui::PushID(i);
+                    if (!read) {
+                        ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                        ImGui::BeginDisabled(true);
+                    }
+                    ImGui::Selectable(context->listing.name_of(id), &selected);
+                    if (!read) {
+                        ImGui::EndDisabled();
+                        ImGui::PopStyleVar();
+                    }
+                    else if (ImGui::IsItemHovered() || ImGui::IsItemFocused()) {
+                        internal_::FileContext::prefetch(context, id);
+                    }
+                    if (settings.dir_sizes)
+                        dir_totals(id);
+                    ImGui::PopID();
 
-                if (*context != nullptr) {
-                    filter    = (*context)->filter_idx;
-                    sort_by   = (*context)->sort_by;
-                    sort_type = (*context)->sort_type;
-                    delete *context;
+                    if (selected && read)
+                        open_dir = static_cast<int>(id);
                 }
+            }
 
-                const auto new_context = new FileContext;
-                new_context->path      = file;
-                new_context->sort_by   = sort_by;
-                new_context->sort_type = sort_type;
-                new_context->read      = can_read(*file);
-                new_context->write     = can_write(*file);
+            ImGui::EndChild();
 
-                if (fs::is_regular_file(og_f) && og_f.has_filename()) {
-                    std::memset(new_context->buffer, 0, FileContext::buffer_size);
-                    std::strncpy(new_context->buffer, og_f.filename().c_str(), FileContext::buffer_size - 1);
+            if (open_dir >= 0) {
+                const auto id       = static_cast<std::uint32_t>(open_dir);
+                const auto dir_path = internal_::FileContext::path_of(context, id);
+                if (internal_::can_read(dir_path)) {
+                    internal_::FileContext::load(&context, dir_path.c_str());
+                    internal_::FileContext::poll(context);
+                    context->peeked = false;
                 }
+                else {
+                    context->listing.flags[id] &= ~ENTRY_READ;
+                }
+            }
 
-                const int     init_dirs  = file->has_parent_path() ? 1 : 0;
-                constexpr int init_files = 0;
+            ImGui::SameLine();
 
-                int dirs_num  = init_dirs;
-                int files_num = init_files;
+            ImGui::BeginChild("##region_files", ImVec2(free_x_des, -reserve_y), ImGuiChildFlags_Borders);
 
-                std::error_code ec;
-                for (fs::directory_iterator it(*file, ec); it != fs::directory_iterator(); it.increment(ec)) {
-                    if (ec)
-                        continue;
+            bool          selection_change = false;
+            bool          double_click     = false;
+            std::uint32_t focused          = UINT32_MAX;
 
-                    const auto &status = it->status(ec);
-                    if (ec)
-                        continue;
+            constexpr float cell_padding_w  = 10.f;
+            const float     scrollbar_width = ImGui::GetStyle().ScrollbarSize + (6.f * cell_padding_w);
 
-                    if (fs::is_directory(status))
-                        dirs_num++;
-                    else if (fs::is_regular_file(status))
-                        files_num++;
-                }
+            const float available_x = ImGui::GetContentRegionAvail().x;
+            const float available_y = ImGui::GetContentRegionAvail().y;
 
-                const auto files = new FileInfo[files_num];
-                const auto dirs  = new FileInfo[dirs_num];
-
-                if (init_dirs > 0) {
-                    dirs[0].path     = new fs::path(file->parent_path());
-                    dirs[0].read     = can_read(file->parent_path());
-                    dirs[0].selected = false;
-                    dirs[0].index    = 0;
-                    dirs[0].size     = 0;
-                    dirs[0].date     = 0;
-                    dirs[0].name     = new char[]{ ".." };
-                    dirs[0].type     = new char[]{ ".." };
-                    dirs[0].time     = new char[]{ ".." };
-                }
+            // measured every frame, instances may live in ImGui contexts with different fonts
+            const auto date_column_width = ImGui::CalcTextSize(" YYYY-MM-DD hh:mm:ss ").x;
+            const auto type_column_width = ImGui::CalcTextSize(" .tar.gz ").x;
+            const auto size_column_width = ImGui::CalcTextSize(" 1023.9 MiB ").x;
+            const auto name_column_width = available_x - (date_column_width + type_column_width + size_column_width + scrollbar_width);
 
-                int d_ = init_dirs, f_ = init_files;
+            const auto border_flags = context->files.empty() ? ImGuiTableFlags_NoBordersInBody : ImGuiTableFlags_BordersInnerV;
+            constexpr auto def_col_flags = ImGuiTableColumnFlags_PreferSortDescending | ImGuiTableColumnFlags_NoHide;
 
-                std::regex pattern;
-                bool       should_filter =
-                        (filter >= 0) && (internal_::filters != nullptr) && (internal_::filters[filter] != nullptr);
-                if (should_filter) {
-                    const auto curr = internal_::filters[filter];
-                    if (std::strlen(curr) == 0 || std::strcmp(curr, "*") == 0 || std::strcmp(curr, " ") == 0) {
-                        should_filter = false;
-                    }
-                    else {
-                        const auto regex_str = glob_to_regex(internal_::filters[filter]);
-                        pattern              = std::regex(regex_str);
-                    }
-                }
+            if (prev_width <= 0)
+                prev_width = available_x;
 
-                for (fs::directory_iterator it(*file, ec); it != fs::directory_iterator(); it.increment(ec)) {
-                    if (ec)
-                        continue;
-
-                    const auto &status = it->status(ec);
-                    if (ec)
-                        continue;
-
-                    if (fs::is_directory(status)) {
-                        const auto ep = new fs::path(it->path());
-                        permissions(status, dirs[d_]);
-                        dirs[d_].path     = ep;
-                        dirs[d_].name     = cpy_str(ep->filename().c_str());
-                        dirs[d_].type     = new char[]{ "" };
-                        dirs[d_].time     = new char[]{ "" };
-                        dirs[d_].selected = false;
-                        dirs[d_].size     = 0;
-                        dirs[d_].date     = 0;
-                        dirs[d_].index    = d_;
-                        d_++;
-                    }
-                    else if (fs::is_regular_file(status)) {
-                        const auto ep = new fs::path(it->path());
-                        if (!should_filter || std::regex_match(ep->filename().string(), pattern)) {
-                            const auto time_entry = fs::last_write_time(*ep);
-                            permissions(status, files[f_]);
-                            files[f_].path = ep;
-                            files[f_].type = cpy_str(ep->has_extension() ? ep->extension().c_str() : new char[]{ "" });
-                            files[f_].name = cpy_str(ep->filename().c_str());
-                            files[f_].date = get_unix_timestamp_ms(time_entry);
-                            files[f_].time = format_time(time_entry);
-                            files[f_].size = it->file_size(ec);
-                            files[f_].selected = false;
-                            files[f_].index    = f_;
-                            f_++;
-                        }
+            int name_col_flags = def_col_flags;
+            if (prev_width != available_x) {
+                name_col_flags |= ImGuiTableColumnFlags_WidthStretch;
+                prev_width = available_x;
+            } else {
+                name_col_flags |= ImGuiTableColumnFlags_WidthFixed;
+            }
+
+            ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(cell_padding_w, 3.0f));
+            if (ImGui::BeginTable("##files_table", 4,
+                                  border_flags | ImGuiTableFlags_NoSavedSettings | ImGuiTableFlags_Sortable |
+                                          ImGuiTableFlags_Resizable | ImGuiTableFlags_PreciseWidths |
+                                          ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit |
+                                          ImGuiTableFlags_SortMulti,
+                                  ImVec2(available_x, available_y))) {
+
+                ImGui::TableSetupColumn(" File", name_col_flags, name_column_width);
+                ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed | def_col_flags, size_column_width);
+                ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed | def_col_flags, type_column_width);
+                ImGui::TableSetupColumn("Date", ImGuiTableColumnFlags_WidthStretch | def_col_flags, date_column_width);
+                ImGui::TableSetupScrollFreeze(1, 1);
+                ImGui::TableHeadersRow();
+
+                if (const auto sp = ImGui::TableGetSortSpecs(); sp != nullptr && sp->SpecsDirty) {
+                    constexpr int max_sort = internal_::FileContext::max_sort;
+
+                    internal_::SortSpec specs[max_sort];
+                    int                 count = 0;
+                    for (int k = 0; sp->Specs != nullptr && k < sp->SpecsCount && count < max_sort; k++) {
+                        specs[count].by    = static_cast<char>(sp->Specs[k].ColumnIndex + 1);
+                        specs[count].order = static_cast<char>(sp->Specs[k].SortDirection);
+                        count++;
                     }
+                    internal_::FileContext::sort(context, specs, count);
+                    sp->SpecsDirty = false;
                 }
 
-                new_context->files_num  = f_;
-                new_context->files      = files;
-                new_context->dirs_num   = dirs_num;
-                new_context->dirs       = dirs;
-                new_context->filter_idx = filter;
+                const auto &listing = context->listing;
 
-                *context = new_context;
-
-                if (sort_by != SORT_NONE && sort_type != SORT_NONE)
-                    FileContext::sort(*context, sort_by, sort_type);
-            }
+                ImGuiListClipper clipper;
+                clipper.Begin(internal_::FileContext::files_num(context));
+                while (clipper.Step()) {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                        const auto id          = context->files[i];
+                        const bool is_selected = listing.selected(id);
+                        bool       selected    = is_selected;
+                        SIMPFP_STAT(rows++;)
 
-            static void reload(FileContext **context) {
-                FileContext::load(context, (*context)->path->c_str());
-            }
+                        const bool disable_select = dir_only || !internal_::FileContext::selectable(context, id);
 
-            static void select_single(FileContext *context, const int index) {
-                if (context->selected_num == 1 && context->files[index].selected)
-                    return;
+                        ImGui::PushID(i);
+                        if (disable_select) {
+                            ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                            ImGui::BeginDisabled(true);
+                        }
 
-                for (int c = 0; c < context->files_num; c++)
-                    context->files[c].selected = false;
-                context->files[index].selected = true;
+                        ImGui::TableNextRow();
 
-                if (context->selected != nullptr && context->selected_num == 1) {
-                    context->selected[0] = &context->files[index];
-                    return;
-                }
+                        ImGui::TableNextColumn();
+                        ImGui::SameLine(0, 5);
+                        ImGui::Selectable(listing.name_of(id), &selected,
+                                          ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap);
 
-                if (context->selected != nullptr)
-                    delete[] context->selected;
-                context->selected     = new FileInfo *[1]{ &context->files[index] };
-                context->selected_num = 1;
-            }
+                        if (ImGui::IsItemClicked(ImGuiMouseButton_Left) &&
+                            ImGui::GetIO().MouseClickedCount[ImGuiMouseButton_Left] == 2) {
+                            double_click = true;
+                        }
 
-            static void unselect_all(FileContext *context) {
-                if (context->selected_num > 1)
-                    std::memset(context->buffer, 0, FileContext::buffer_size);
-                for (int i = 0; i < context->files_num; i++)
-                    context->files[i].selected = false;
-                if (context->selected != nullptr)
-                    delete[] context->selected;
-                context->selected_num = 0;
-                context->selected     = nullptr;
-            }
+                        if (ImGui::IsItemFocused())
+                            focused = id;
 
-            static void select_add(FileContext *context, const int index) {
-                if (context->selected == nullptr || context->selected_num <= 0) {
-                    if (context->selected != nullptr)
-                        delete[] context->selected;
-                    context->selected              = new FileInfo *[1]{ &context->files[index] };
-                    context->selected_num          = 1;
-                    context->files[index].selected = true;
-                    return;
-                }
+                        const auto &cells = context->cells.get(listing, id, human_size);
 
-                if (context->files[index].selected)
-                    return;
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(cells.size);
 
-                const auto new_arr = new FileInfo *[context->selected_num + 1];
-                std::memcpy(new_arr, context->selected, sizeof(FileInfo *) * context->selected_num);
-                new_arr[context->selected_num] = &context->files[index];
-                context->files[index].selected = true;
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(listing.type_of(id));
 
-                delete[] context->selected;
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(cells.time);
+                        ImGui::SameLine(0, 5);
+                        ImGui::TextDisabled(" ");
 
-                context->selected_num = context->selected_num + 1;
-                context->selected     = new_arr;
-            }
+                        if (disable_select) {
+                            ImGui::EndDisabled();
+                            ImGui::PopStyleVar();
+                        }
 
-            static void select_range(FileContext *context, const int index) {
-                if (context->selected == nullptr || context->selected_num <= 0) {
-                    if (context->selected != nullptr)
-                        delete[] context->selected;
-                    context->selected              = new FileInfo *[1]{ &context->files[index] };
-                    context->selected_num          = 1;
-                    context->files[index].selected = true;
-                    return;
-                }
+                        ImGui::PopID();
 
-                const int idx_min = context->selected[0]->index;
-                const int idx_max = context->selected[context->selected_num - 1]->index;
+                        if (dir_only)
+                            continue;
 
-                const int idx_st = std::min(idx_min, index);
-                const int idx_ed = std::max(idx_max, index);
-                const int size   = idx_ed - idx_st + 1;
+                        if (selected == is_selected)
+                            continue;
 
-                if (size == 1) {
-                    select_single(context, index);
-                    return;
-                }
+                        selection_change = true;
 
-                if (context->selected_num != size)
-                    delete[] context->selected;
+                        if (!single && key_shift) {
+                            internal_::FileContext::select_range(context, i, key_ctrl);
+                            continue;
+                        }
 
-                context->selected     = new FileInfo *[size];
-                context->selected_num = size;
+                        if (!single && key_ctrl) {
+                            internal_::FileContext::select_toggle(context, i);
+                            continue;
+                        }
 
-                for (int c = 0, k = 0; c < context->files_num; c++) {
-                    if (c >= idx_st && c <= idx_ed) {
-                        context->files[c].selected = true;
-                        context->selected[k++]     = &context->files[c];
-                        continue;
+                        internal_::FileContext::select_single(context, i);
                     }
-                    context->files[c].selected = false;
                 }
+
+                ImGui::EndTable();
+            }
+            ImGui::PopStyleVar();
+            ImGui::EndChild();
+
+            if (show_preview) {
+                // keyboard focus moves ahead of selection while browsing with arrow keys
+                if (focused == UINT32_MAX && !context->selected.empty())
+                    focused = context->selected.back();
+                ImGui::SameLine();
+                preview_pane(focused, free_x_pre, -reserve_y);
             }
 
-            static void sort(FileContext *context, const char by, const char order) {
-                context->sort_by   = by;
-                context->sort_type = order;
+            if (!single && !dir_only && key_ctrl && ImGui::IsKeyPressed(ImGuiKey_A) &&
+                !ImGui::GetIO().WantTextInput && ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+                internal_::FileContext::select_all(context);
+                selection_change = true;
+            }
 
-                if (by <= 0 || order <= 0)
-                    return;
+            char                 *buffer  = context->buffer;
+            constexpr std::size_t max_len = internal_::FileContext::buffer_size - 1;
 
-                if (by == SORT_NAME) {
-                    if (order == SORT_ASC) {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return std::strcmp(a.name, b.name) < 0; });
-                    }
-                    else {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return std::strcmp(a.name, b.name) > 0; });
-                    }
-                }
+            if (selection_change) {
+                context->peeked   = false;
+                selection_changed = true;
+                internal_::FileContext::update_buffer(context);
+            }
 
-                else if (by == SORT_TYPE) {
-                    if (order == SORT_ASC) {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return std::strcmp(a.type, b.type) < 0; });
-                    }
-                    else {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return std::strcmp(a.type, b.type) > 0; });
-                    }
-                }
+            float alpha = 1.0f;
+            if (dir_only || context->selected.size() > 1) {
+                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                ImGui::BeginDisabled(true);
+                alpha = 0.5f;
+            }
 
-                else if (by == SORT_SIZE) {
-                    if (order == SORT_ASC) {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return a.size < b.size; });
-                    }
-                    else {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return a.size > b.size; });
-                    }
-                }
+            const bool      has_filters  = settings.filters != nullptr;
+            constexpr float filters_size = 100.f;
 
-                else if (by == SORT_TIME) {
-                    if (order == SORT_ASC) {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return a.date < b.date; });
-                    }
-                    else {
-                        std::sort(context->files, context->files + context->files_num,
-                                  [](const FileInfo &a, const FileInfo &b) { return a.date > b.date; });
-                    }
-                }
+            if (full_width_input(buffer, max_len, alpha, has_filters ? filters_size : 0.f)) {
+                internal_::FileContext::unselect_all(context);
+                context->peeked   = false;
+                selection_changed = true;
             }
-        };
 
-        inline bool display(const bool should) {
-            if (!should)
-              return false;
+            if (dir_only || context->selected.size() > 1) {
+                ImGui::EndDisabled();
+                ImGui::PopStyleVar();
+            }
 
-            const auto center = ImGui::GetMainViewport()->GetCenter();
-            ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+            if (has_filters && select_filter(context)) {
+                internal_::FileContext::apply_filters(&context);
+                context->peeked = false;
+            }
 
-            const bool show = ImGui::BeginPopupModal(internal_::title, internal_::open_ptr,
-                                                     ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoDocking |
-                                                             (internal_::resizable ? 0 : ImGuiWindowFlags_NoResize));
+            ImGui::Spacing();
 
-            if (!show) {
-                reset_vars();
-            }
+            const bool can_save = context->read && (context->write || settings.read_only) &&
+                                  (accept_empty || std::strlen(buffer) > 0);
 
-            return show;
-        }
+            bool create = false;
+            bool cancel = false;
+            bool accept = false;
 
-        inline bool show_dialog(const char *title, bool *open = nullptr, const ImVec2 *size = nullptr,
-                                const bool resizable = true) {
-            if (open != nullptr && !*open) {
-                internal_::reset_vars();
-                return display(false);
+            if (!settings.read_only) {
+                if (context->read && context->write)
+                    buttons_dir(&create);
+                else
+                  buttons_dir(nullptr);
+            } else {
+                ImGui::Dummy(ImVec2(1.0f, ImGui::GetFrameHeight()));
             }
 
-            if (title == nullptr) {
-                internal_::reset_vars();
-                return display(false);
+            if (toggle_hidden()) {
+                internal_::FileContext::apply_filters(&context);
+                context->peeked = false;
             }
 
-            if (internal_::title == title) {
-                if (internal_::closed) {
-                    if (open != nullptr)
-                        *open = false;
-                    return display(false);
-                }
+            if (toggle_tree()) {
+                internal_::FileContext::reload(&context);
+                context->peeked = false;
+            }
 
-                if (internal_::reset) {
-                    if (size != nullptr) {
-                        ImGui::SetNextWindowSizeConstraints(*size, ImVec2(-1, -1));
-                        ImGui::SetNextWindowSize(*size, ImGuiCond_Appearing);
-                    }
-                    internal_::resizable = resizable;
-                    internal_::reset     = false;
-                    ImGui::OpenPopup(internal_::title, ImGuiPopupFlags_NoReopen);
+            ImGui::Spacing();
+
+            buttons_action(&cancel, can_save ? &accept : nullptr);
+
+            if (cancel) {
+                if (open_ptr != nullptr)
+                    *open_ptr = false;
+                closed = true;
+                ImGui::CloseCurrentPopup();
+                ImGui::EndPopup();
+                if (context != nullptr) {
+                    delete context;
+                    context = nullptr;
                 }
+                return;
+            }
 
-                internal_::open_ptr = open;
-                return display(true);
+            bool &allowed = new_name_allowed;
+            if (!settings.read_only && create) {
+                allowed = false;
+                std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
+                ImGui::OpenPopup(labels.dir_title);
             }
 
-            internal_::open_ptr  = open;
-            internal_::title     = title;
-            internal_::reset     = false;
-            internal_::closed    = false;
-            internal_::resizable = resizable;
+            const auto offset     = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
+            const auto title_size = ImGui::CalcTextSize(labels.dir_input).x + offset * 4;
 
-            if (size != nullptr) {
-                ImGui::SetNextWindowSizeConstraints(*size, ImVec2(-1, -1));
-                ImGui::SetNextWindowSize(*size, ImGuiCond_Appearing);
-            }
-            ImGui::OpenPopup(internal_::title, ImGuiPopupFlags_NoReopen);
-            return display(true);
-        }
+            const auto center = ImGui::GetMainViewport()->GetCenter();
+            ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+            ImGui::SetNextWindowSize(ImVec2(title_size, 0));
 
-        inline bool full_width_input(char *buffer, const std::size_t buffer_size, const float alpha = 1.0f,
-                                     const float padding_right = 0.f) {
-            static bool updated  = false;
-            static auto callback = [](ImGuiInputTextCallbackData *data) -> int {
-                if (data->EventFlag == ImGuiInputTextFlags_CallbackEdit)
-                    updated = true;
-                return 0;
-            };
+            if (!settings.read_only &&
+                ImGui::BeginPopupModal(labels.dir_title, nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
 
-            const auto input_pos  = ImGui::GetCursorScreenPos();
-            const auto input_size = ImVec2(ImGui::GetContentRegionAvail().x - padding_right, ImGui::GetFrameHeight());
+                ImGui::Spacing();
+                ImGui::Spacing();
 
-            ImGui::SetNextItemWidth(input_size.x);
-            ImGui::InputText("##bordered_input", buffer, buffer_size, ImGuiInputTextFlags_CallbackEdit, callback);
+                ImGui::Text("%s", labels.dir_input);
+                ImGui::Spacing();
 
-            ImGui::GetWindowDrawList()->AddRect(input_pos,
-                                                ImVec2(input_pos.x + input_size.x, input_pos.y + input_size.y),
-                                                IM_COL32(0, 0, 0, 90 * alpha));
+                if (full_width_input(new_name_buffer, sizeof(new_name_buffer))) {
+                    allowed = std::strlen(new_name_buffer) > 0 &&
+                              !internal_::fs::exists(*context->path / new_name_buffer);
+                }
 
-            if (updated) {
-                updated = false;
-                return true;
-            }
+                ImGui::Spacing();
+                ImGui::Spacing();
 
-            return false;
-        }
+                const float ok_size = ImGui::CalcTextSize(labels.dir_accept).x + offset;
+                const float no_size = ImGui::CalcTextSize(labels.dir_cancel).x + offset;
+                const float free_w  = ImGui::GetContentRegionMax().x;
+                const float spacing = ImGui::GetStyle().ItemSpacing.x;
 
-        inline void buttons_dir(bool *create) {
-            const float offset  = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
-            const float ok_size = ImGui::CalcTextSize(internal_::labels.main_create).x + offset;
+                ImGui::SetCursorPosX(free_w - (ok_size + no_size + spacing));
 
-            if (create == nullptr) {
-                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-                ImGui::BeginDisabled(true);
+                if (!allowed) {
+                    ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                    ImGui::BeginDisabled(true);
+                }
+                if (ImGui::Button(labels.dir_accept, ImVec2(ok_size, 0)) && allowed) {
+                    allowed            = false;
+                    const auto new_dir = *context->path / new_name_buffer;
+                    if (!internal_::fs::exists(new_dir) && internal_::fs::create_directory(new_dir)) {
+                        std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
+                        ImGui::CloseCurrentPopup();
+                        // watcher picks new directory up on its own
+                        if (!internal_::FileContext::watching(context))
+                            internal_::FileContext::reload(&context);
+                        context->peeked = false;
+                    }
+                }
+                if (!allowed) {
+                    ImGui::EndDisabled();
+                    ImGui::PopStyleVar();
+                }
+
+                ImGui::SameLine();
+                if (ImGui::Button(labels.dir_cancel, ImVec2(no_size, 0))) {
+                    std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
+                    ImGui::CloseCurrentPopup();
+                    allowed = false;
+                }
+                ImGui::EndPopup();
             }
 
-            if (ImGui::Button(internal_::labels.main_create, ImVec2(ok_size, 0))) {
-                if (create != nullptr)
-                    *create = true;
+            SIMPFP_STAT(context->stats.frame_ns  = internal_::elapsed_ns(frame_started);
+                        context->stats.rows      = rows;
+                        context->stats.format_ns = context->cells.format_ns;
+                        context->stats.formatted = context->cells.formatted;)
+            if (show_stats)
+                stats_overlay(context);
+
+            if (accept || (can_save && double_click)) {
+                context->accepted = true;
+                ImGui::EndPopup();
+                notify(true);
+                return;
             }
 
-            if (create == nullptr) {
-                ImGui::EndDisabled();
-                ImGui::PopStyleVar();
+            ImGui::EndPopup();
+            notify(false);
+
+            if (open_ptr != nullptr && !*open_ptr) {
+                closed = true;
+                if (context != nullptr) {
+                    delete context;
+                    context = nullptr;
+                }
             }
         }
 
-        inline void buttons_action(bool *cancel, bool *accept) {
-            const float offset  = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
-            const float spacing = ImGui::GetStyle().ItemSpacing.x;
+        void UnselectAll() {
+            if (context == nullptr)
+                return;
+            internal_::FileContext::unselect_all(context);
+            context->accepted = false;
+            context->peeked   = true;
+            selection_changed = true;
+        }
 
-            const float ok_size = ImGui::CalcTextSize(internal_::labels.main_accept).x + offset;
-            const float no_size = ImGui::CalcTextSize(internal_::labels.main_cancel).x + offset;
+        void SelectAll() {
+            if (context == nullptr || dir_only)
+                return;
+            internal_::FileContext::select_all(context);
+            internal_::FileContext::update_buffer(context);
+            context->accepted = false;
+            context->peeked   = false;
+            selection_changed = true;
+        }
 
-            const float max_size = ok_size > no_size ? ok_size : no_size;
+        void InvertSelection() {
+            if (context == nullptr || dir_only)
+                return;
+            internal_::FileContext::select_invert(context);
+            internal_::FileContext::update_buffer(context);
+            context->accepted = false;
+            context->peeked   = false;
+            selection_changed = true;
+        }
 
+        long SelectMatching(const char *glob) {
+            if (context == nullptr || dir_only)
+                return 0;
+            const long count = internal_::FileContext::select_matching(context, glob);
+            if (count < 0)
+                return 0;
+            internal_::FileContext::update_buffer(context);
+            context->accepted = false;
+            context->peeked   = false;
+            selection_changed = true;
+            return count;
+        }
 
-            const float available_width = ImGui::GetContentRegionMax().x;
+        void Search(const char *query) {
+            if (context == nullptr)
+                return;
+            std::memset(context->search_buffer, 0, internal_::FileContext::search_size);
+            if (query != nullptr)
+                std::strncpy(context->search_buffer, query, internal_::FileContext::search_size - 1);
+            internal_::FileContext::search(context, context->search_buffer);
+        }
 
-            ImGui::SetCursorPosX(available_width - (max_size + max_size + spacing));
+        void ResetBuffer() {
+            if (context == nullptr)
+                return;
+            std::memset(context->buffer, 0, internal_::FileContext::buffer_size);
+            context->accepted = false;
+            context->peeked   = true;
+            selection_changed = true;
+        }
 
-            if (cancel == nullptr) {
-                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-                ImGui::BeginDisabled(true);
-            }
-            if (ImGui::Button(internal_::labels.main_cancel, ImVec2(max_size, 0))) {
-                if (cancel != nullptr)
-                    *cancel = true;
-            }
-            if (cancel == nullptr) {
-                ImGui::EndDisabled();
-                ImGui::PopStyleVar();
-            }
-
-            ImGui::SameLine();
+        void Reload() {
+            if (context == nullptr)
+                return;
+            std::memset(context->buffer, 0, internal_::FileContext::buffer_size);
+            internal_::FileContext::reload(&context);
+            context->accepted = false;
+            context->peeked   = true;
+        }
 
-            if (accept == nullptr) {
-                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-                ImGui::BeginDisabled(true);
-            }
-            if (ImGui::Button(internal_::labels.main_accept, ImVec2(max_size, 0))) {
-                if (accept != nullptr)
-                    *accept = true;
-            }
-            if (accept == nullptr) {
-                ImGui::EndDisabled();
-                ImGui::PopStyleVar();
-            }
+        void FilterIgnoreCase(const bool enable) {
+            internal_::FileContext::set_icase(settings, &context, enable);
         }
 
-        inline bool select_filter(FileContext *context, const float alpha = 1.f) {
-            ImGui::SameLine();
-            constexpr float field_size      = 100.f;
-            const float     available_width = ImGui::GetContentRegionMax().x;
-            const float     spacing         = ImGui::GetStyle().ItemSpacing.x;
+        void ShowHiddenFiles(const bool enable) {
+            internal_::FileContext::set_hidden(settings, &context, enable);
+        }
 
-            ImGui::SetCursorPosX(available_width - (field_size) + spacing);
-            ImGui::PushItemWidth(field_size - spacing);
+        void RecursiveListing(const bool enable, const int max_depth = 32) {
+            internal_::FileContext::set_recursive(settings, &context, enable, max_depth);
+        }
 
-            const auto input_pos  = ImGui::GetCursorScreenPos();
-            const auto input_size = ImVec2(field_size - spacing, ImGui::GetFrameHeight());
+        void HumanReadableSize(const bool enable) {
+            human_size = enable;
+        }
 
-            const auto prev_index = context->filter_idx;
+        void NaturalSort(const bool enable) {
+            internal_::FileContext::set_natural(settings, &context, enable);
+        }
 
-            if (ImGui::BeginCombo("##filters", internal_::filters[context->filter_idx],
-                                  ImGuiComboFlags_HeightRegular)) {
-                for (int n = 0; internal_::filters[n] != nullptr; n++) {
-                    const bool is_selected = (context->filter_idx == n);
-                    ImGui::PushID(n);
-                    if (ImGui::Selectable(internal_::filters[n], is_selected))
-                        context->filter_idx = n;
-                    if (is_selected)
-                        ImGui::SetItemDefaultFocus();
-                    ImGui::PopID();
-                }
-                ImGui::EndCombo();
-            }
-            ImGui::PopItemWidth();
+        void WatchDirectory(const bool enable) {
+            internal_::FileContext::set_watch(settings, &context, enable);
+        }
 
-            ImGui::GetWindowDrawList()->AddRect(input_pos,
-                                                ImVec2(input_pos.x + input_size.x, input_pos.y + input_size.y),
-                                                IM_COL32(0, 0, 0, 90 * alpha));
+        PhaseStats Stats() const {
+            return context == nullptr ? PhaseStats() : context->stats;
+        }
 
-            return context->filter_idx != prev_index;
+        void ShowStatsOverlay(const bool enable) {
+            show_stats = enable;
         }
 
-    } // namespace internal_
+        void DirectorySizes(const bool enable) {
+            internal_::FileContext::set_dir_sizes(settings, &context, enable);
+        }
 
-    inline internal_::FileContext *context = nullptr;
+        void PrefetchListings(const bool enable) {
+            internal_::FileContext::set_prefetch(settings, enable);
+        }
 
-    inline void OpenFileDialog(const char *title, const char *default_path, const char **filters, const Labels *labels,
-                               const bool read_only, const bool accept_empty, const bool dir_only) {
-        internal_::open_ptr     = nullptr;
-        internal_::closed       = false;
-        internal_::single       = true;
-        internal_::reset        = true;
-        internal_::title        = title;
-        internal_::filters      = filters;
-        internal_::dir_only     = dir_only;
-        internal_::read_only    = read_only;
-        internal_::file_path    = default_path;
-        internal_::accept_empty = accept_empty || dir_only;
-
-        if (labels != nullptr) {
-            internal_::labels = *labels;
+        void ShowPreviewPane(const bool enable) {
+            show_preview = enable;
+            if (!enable)
+                previewer.clear();
         }
-        if (context != nullptr) {
-            delete context;
-            context = nullptr;
+
+        long CountSelected() const {
+            if (context == nullptr)
+                return 0;
+            return static_cast<long>(context->selected.size());
         }
-    }
 
-    inline bool FileDialogOpen() {
-        return !internal_::closed;
-    }
+        const char *CurrentPath() const {
+            if (context == nullptr || context->path == nullptr)
+                return nullptr;
+            return context->path->c_str();
+        }
 
-    inline void CloseFileDialog() {
-        *internal_::open_ptr = false;
-        internal_::closed    = true;
-        if (context != nullptr) {
-            delete context;
-            context = nullptr;
+        bool FilterSelected(int *filter_idx) {
+            if (context == nullptr || settings.filters == nullptr)
+                return false;
+            *filter_idx = context->filter_idx;
+            return true;
         }
-    }
 
-    inline bool ShowFileDialog(const char *label, bool *open) {
-        return internal_::show_dialog(label, open);
-    }
+        bool PeekSelected(char *buffer_out, const std::size_t size) {
+            if (context == nullptr || context->peeked)
+                return false;
 
-    inline bool ShowFileDialog(const char *label, bool *open, const ImVec2 &size, const bool resize) {
-        return internal_::show_dialog(label, open, &size, resize);
-    }
+            context->peeked = true;
 
-    inline void EndFileDialog() {
-        if (internal_::closed) {
-            if (internal_::open_ptr != nullptr)
-                *internal_::open_ptr = false;
-            if (context != nullptr) {
-                delete context;
-                context = nullptr;
-            }
-            ImGui::EndPopup();
-            return;
-        }
+            if (context->selected.empty()) {
+                context->peeked = true;
 
-        if (internal_::open_ptr != nullptr && !*internal_::open_ptr) {
-            internal_::closed = true;
-            if (context != nullptr) {
-                delete context;
-                context = nullptr;
-            }
-            ImGui::EndPopup();
-            return;
-        }
+                if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
+                    std::memset(buffer_out, 0, size);
+                    std::strncpy(buffer_out, context->path->c_str(), size);
+                    return true;
+                }
 
-        if (context == nullptr) {
-            internal_::FileContext::load(&context, internal_::file_path);
-            if (internal_::filters != nullptr) {
-                context->filter_idx = 0;
+                std::memset(buffer_out, 0, size);
+                std::strncpy(buffer_out, (*context->path / context->buffer).c_str(), size);
+                return true;
             }
-        }
 
-        static const float reserve_y = (ImGui::GetFrameHeight() * 4) + ImGui::GetStyle().ItemSpacing.y;
+            const auto selected = context->selected[0];
 
-        constexpr float ratio     = 0.25f;
-        const float     spacing_x = ImGui::GetStyle().ItemSpacing.x;
-        const float     free_x    = ImGui::GetContentRegionAvail().x - spacing_x;
+            if (context->selected.size() == 1) {
+                std::memset(buffer_out, 0, size);
+                std::strncpy(buffer_out, (*context->path / context->buffer).c_str(),
+                             size);
+                return true;
+            }
 
-        const float free_x_uno = free_x * ratio;
-        const float free_x_des = free_x * (1.f - ratio);
+            std::memset(buffer_out, 0, size);
+            std::strncpy(buffer_out, internal_::FileContext::path_of(context, selected).c_str(), size);
+            return true;
+        }
 
-        const bool key_shift = ImGui::IsKeyPressed(ImGuiKey_LeftShift) || ImGui::IsKeyDown(ImGuiKey_LeftShift);
-        const bool key_ctrl  = ImGui::IsKeyPressed(ImGuiKey_LeftCtrl) || ImGui::IsKeyDown(ImGuiKey_LeftCtrl);
+        bool PeekSelected(char *buffer_out, const std::size_t size, const std::size_t index) {
+            std::size_t &last_index = peek_index;
+            single                  = false;
 
-        if (ImGui::IsKeyPressed(ImGuiKey_Escape) || ImGui::IsKeyDown(ImGuiKey_Escape)) {
-            *internal_::open_ptr = false;
-            internal_::closed    = true;
-            ImGui::CloseCurrentPopup();
-            ImGui::EndPopup();
-            if (context != nullptr) {
-                delete context;
-                context = nullptr;
+            if (index < last_index || context == nullptr || context->peeked) {
+                if (context != nullptr)
+                    context->peeked = true;
+                last_index = 0;
+                return false;
             }
-            return;
-        }
 
-        ImGui::Spacing();
-        ImGui::Text("%s", context->path->c_str());
-        ImGui::SameLine(ImGui::GetWindowWidth() - ImGui::CalcTextSize("*").x - ImGui::GetStyle().FramePadding.x -
-                        ImGui::GetStyle().ItemSpacing.x);
-        ImGui::TextDisabled("%s", (key_shift || key_ctrl) ? "*" : "");
+            last_index = index;
+            if (context->selected.size() <= index) {
+                context->peeked = true;
+                last_index      = 0;
 
-        ImGui::BeginChild("##region_dirs", ImVec2(free_x_uno, -reserve_y), ImGuiChildFlags_Borders);
+                if (index == 0) {
 
-        for (int i = 0; i < context->dirs_num; i++) {
-            auto &dir      = context->dirs[i];
-            bool  selected = false;
+                    if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
+                        std::memset(buffer_out, 0, size);
+                        std::strncpy(buffer_out, context->path->c_str(), size);
+                        return true;
+                    }
 
-            ImGui::PushID(i);
-            if (!dir.read) {
-                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-                ImGui::BeginDisabled(true);
+                    std::memset(buffer_out, 0, size);
+                    std::strncpy(buffer_out, (*context->path / context->buffer).c_str(), size);
+                    return true;
+                }
+                return false;
             }
-            ImGui::Selectable(dir.name, &selected);
-            if (!dir.read) {
-                ImGui::EndDisabled();
-                ImGui::PopStyleVar();
+
+            const auto selected = context->selected[index];
+
+            if (index + 1 >= context->selected.size()) {
+                context->peeked = true;
+                last_index      = 0;
             }
-            ImGui::PopID();
 
-            if (selected && dir.read) {
-                dir.read = internal_::can_read(internal_::fs::absolute(*dir.path));
-                if (!dir.read)
-                    continue;
-                internal_::FileContext::load(&context, internal_::fs::absolute(*dir.path).c_str());
-                context->peeked = false;
+            if (context->selected.size() == 1) {
+                context->peeked = true;
+                last_index      = 0;
+                std::memset(buffer_out, 0, size);
+                std::strncpy(buffer_out, (*context->path / context->buffer).c_str(),
+                             size);
+                return true;
             }
+
+            std::memset(buffer_out, 0, size);
+            std::strncpy(buffer_out, internal_::FileContext::path_of(context, selected).c_str(), size);
+            return true;
         }
 
-        ImGui::EndChild();
+        bool FileAccepted(char *buffer_out, const std::size_t size, const std::size_t index) {
+            std::size_t &last_index = accept_index;
+            single                  = false;
 
-        ImGui::SameLine();
+            if (index < last_index || context == nullptr || !context->accepted) {
+                if (context != nullptr)
+                    context->accepted = false;
+                last_index = 0;
+                return false;
+            }
 
-        ImGui::BeginChild("##region_files", ImVec2(free_x_des, -reserve_y), ImGuiChildFlags_Borders);
+            last_index = index;
 
-        bool selection_change = false;
-        bool double_click     = false;
+            if (context->selected.size() <= index) {
+                context->accepted = false;
+                last_index        = 0;
 
-        constexpr float cell_padding_w = 10.f;
-        static const float scrollbar_width = ImGui::GetStyle().ScrollbarSize + (6.f * cell_padding_w);
+                if (index == 0) {
 
-        const float available_x = ImGui::GetContentRegionAvail().x;
-        const float available_y = ImGui::GetContentRegionAvail().y;
+                    if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
+                        if (accept_empty) {
+                            std::memset(buffer_out, 0, size);
+                            std::strncpy(buffer_out, context->path->c_str(), size);
+                            return true;
+                        }
+                        return false;
+                    }
 
-        static auto date_column_width = ImGui::CalcTextSize(" YYYY-MM-DD hh:mm:ss ").x;
-        static auto type_column_width = ImGui::CalcTextSize(" .tar.gz ").x;
-        static auto size_column_width = ImGui::CalcTextSize(" 1234567 ").x;
-        const auto name_column_width = available_x - (date_column_width + type_column_width + size_column_width + scrollbar_width);
+                    std::memset(buffer_out, 0, size);
+                    std::strncpy(buffer_out, (*context->path / context->buffer).c_str(), size);
+                    return true;
+                }
+                return false;
+            }
 
-        const auto border_flags = (context->files_num <= 0) ? ImGuiTableFlags_NoBordersInBody : ImGuiTableFlags_BordersInnerV;
-        constexpr auto def_col_flags = ImGuiTableColumnFlags_PreferSortDescending | ImGuiTableColumnFlags_NoHide;
+            const auto selected = context->selected[index];
 
-        static float prev_width = available_x;
-        int name_col_flags = def_col_flags;
-        if (prev_width != available_x) {
-            name_col_flags |= ImGuiTableColumnFlags_WidthStretch;
-            prev_width = available_x;
-        } else {
-            name_col_flags |= ImGuiTableColumnFlags_WidthFixed;
-        }
+            if (context->selected.size() == 1) {
+                context->accepted = false;
+                last_index        = 0;
 
-        ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, ImVec2(cell_padding_w, 3.0f));
-        if (ImGui::BeginTable("##files_table", 4,
-                              border_flags | ImGuiTableFlags_NoSavedSettings | ImGuiTableFlags_Sortable |
-                                      ImGuiTableFlags_Resizable | ImGuiTableFlags_PreciseWidths |
-                                      ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit,
-                              ImVec2(available_x, available_y))) {
-
-            ImGui::TableSetupColumn(" File", name_col_flags, name_column_width);
-            ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed | def_col_flags, size_column_width);
-            ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_WidthFixed | def_col_flags, type_column_width);
-            ImGui::TableSetupColumn("Date", ImGuiTableColumnFlags_WidthStretch | def_col_flags, date_column_width);
-            ImGui::TableSetupScrollFreeze(1, 1);
-            ImGui::TableHeadersRow();
-
-            if (const auto sp = ImGui::TableGetSortSpecs(); sp != nullptr && sp->SpecsDirty) {
-                if (const auto cs = sp->Specs) {
-                    internal_::FileContext::sort(context, (cs->ColumnIndex + 1), cs->SortDirection);
-                    internal_::FileContext::unselect_all(context);
-                }
-                sp->SpecsDirty = false;
+                std::memset(buffer_out, 0, size);
+                std::strncpy(buffer_out, (*context->path / context->buffer).c_str(),
+                             size);
+                return true;
             }
 
-            for (int i = 0; i < context->files_num; i++) {
-                const auto &file     = context->files[i];
-                bool        selected = file.selected;
+            std::memset(buffer_out, 0, size);
+            std::strncpy(buffer_out, internal_::FileContext::path_of(context, selected).c_str(), size);
 
-                const bool disable_select = internal_::dir_only || !file.read || (!file.write && !internal_::read_only);
+            if (index + 1 >= context->selected.size()) {
+                context->accepted = false;
+                last_index        = 0;
+            }
 
-                ImGui::PushID(i);
-                if (disable_select) {
-                    ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-                    ImGui::BeginDisabled(true);
-                }
+            return true;
+        }
+
+        std::size_t ForEachAccepted(const std::function<bool(const char *path)> &callback) {
+            if (context == nullptr || !context->accepted)
+                return 0;
+            context->accepted = false;
+            return report(callback);
+        }
+
+        std::size_t ForEachSelected(const std::function<bool(const char *path)> &callback) {
+            if (context == nullptr)
+                return 0;
+            return report(callback);
+        }
 
-                ImGui::TableNextRow();
+        bool FileAccepted(char *buffer_out, const std::size_t size) {
+            if (context == nullptr || !context->accepted)
+                return false;
 
-                ImGui::TableNextColumn();
-                ImGui::SameLine(0, 5);
-                ImGui::Selectable(file.name, &selected,
-                                  ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap);
+            context->accepted = false;
 
-                if (ImGui::IsItemClicked(ImGuiMouseButton_Left) &&
-                    ImGui::GetIO().MouseClickedCount[ImGuiMouseButton_Left] == 2) {
-                    double_click = true;
+            if (context->selected.empty()) {
+                if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
+                    if (accept_empty) {
+                        std::memset(buffer_out, 0, size);
+                        std::strncpy(buffer_out, context->path->c_str(), size);
+                        return true;
+                    }
+                    return false;
                 }
 
-                ImGui::TableNextColumn();
-                ImGui::Text("%lu", file.size);
+                std::memset(buffer_out, 0, size);
+                std::strncpy(buffer_out, (*context->path / context->buffer).c_str(), size);
+                return true;
+            }
 
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", file.type);
+            // input buffer only holds a summary of multi-selection
+            const auto path = context->selected.size() > 1 ? internal_::FileContext::path_of(context, context->selected[0])
+                                                           : *context->path / context->buffer;
+            std::memset(buffer_out, 0, size);
+            std::strncpy(buffer_out, path.c_str(), size);
+            return true;
+        }
 
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", file.time);
-                ImGui::SameLine(0, 5);
-                ImGui::TextDisabled(" ");
+        PathSpan AcceptedPaths() {
+            if (context == nullptr || !context->accepted)
+                return {};
+            context->accepted = false;
+            return collect(accepted_paths);
+        }
 
-                if (disable_select) {
-                    ImGui::EndDisabled();
-                    ImGui::PopStyleVar();
-                }
+        PathSpan SelectedPaths() {
+            return context == nullptr ? PathSpan() : collect(selected_paths);
+        }
 
-                ImGui::PopID();
+        void OnSelectionChanged(std::function<void(PathSpan paths)> callback) {
+            on_selection = std::move(callback);
+        }
 
-                if (internal_::dir_only)
-                    continue;
+        void OnFileAccepted(std::function<void(PathSpan paths)> callback) {
+            on_accepted = std::move(callback);
+        }
 
-                if (selected == file.selected)
-                    continue;
+        void OnDirectoryChanged(std::function<void(const char *path)> callback) {
+            on_directory = std::move(callback);
+        }
 
-                selection_change = true;
+    private:
+        const char             *title        = nullptr;
+        const char             *file_path    = nullptr;
+        bool                   *open_ptr     = nullptr;
+        bool                    reset        = false;
+        bool                    closed       = true;
+        bool                    resizable    = true;
+        bool                    single       = true;
+        bool                    accept_empty = false;
+        bool                    dir_only     = false;
+        bool                    human_size   = false;
+        bool                    show_stats   = false;
+        bool                    show_preview = false;
+        internal_::Settings     settings;
+        Labels                  labels;
+        internal_::FileContext *context      = nullptr;
+
+        std::size_t peek_index       = 0; // last index given to indexed PeekSelected()
+        std::size_t accept_index     = 0; // last index given to indexed FileAccepted()
+        float       prev_width       = 0;
+        bool        new_name_allowed = false;
+        char        new_name_buffer[128]{};
+
+        internal_::Previewer previewer;
+
+        struct Batch {
+            std::string                   block;
+            std::vector<std::string_view> views;
+        };
 
-                if (!internal_::single && key_ctrl) {
-                    internal_::FileContext::select_add(context, i);
-                    continue;
-                }
+        Batch       accepted_paths;
+        Batch       selected_paths;
+        Batch       event_paths;
+        std::string last_dir;
+        bool        selection_changed = false;
+
+        std::function<void(PathSpan paths)>   on_selection;
+        std::function<void(PathSpan paths)>   on_accepted;
+        std::function<void(const char *path)> on_directory;
+
+        void reset_vars() {
+            open_ptr           = nullptr;
+            title              = nullptr;
+            reset              = false;
+            closed             = true;
+            resizable          = true;
+            single             = true;
+            accept_empty       = false;
+            dir_only           = false;
+            labels             = Labels();
+            settings.filters   = nullptr;
+            settings.read_only = false;
+            settings.selected  = labels.selected;
+        }
 
-                if (!internal_::single && key_shift) {
-                    internal_::FileContext::select_range(context, i);
-                    continue;
-                }
+        bool display(const bool should) {
+            if (!should)
+              return false;
+
+            const auto center = ImGui::GetMainViewport()->GetCenter();
+            ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
 
-                internal_::FileContext::select_single(context, i);
+            const bool show = ImGui::BeginPopupModal(title, open_ptr,
+                                                     ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoDocking |
+                                                             (resizable ? 0 : ImGuiWindowFlags_NoResize));
+
+            if (!show) {
+                reset_vars();
             }
 
-            ImGui::EndTable();
+            return show;
         }
-        ImGui::PopStyleVar();
-        ImGui::EndChild();
-
-        char                 *buffer  = context->buffer;
-        constexpr std::size_t max_len = internal_::FileContext::buffer_size - 1;
 
-        if (selection_change) {
-            context->peeked = false;
-            std::memset(buffer, 0, internal_::FileContext::buffer_size);
+        bool show_dialog(const char *label, bool *open = nullptr, const ImVec2 *size = nullptr,
+                         const bool resize = true) {
+            if (open != nullptr && !*open) {
+                reset_vars();
+                return display(false);
+            }
 
-            if (context->selected != nullptr && context->selected_num == 1) {
-                const auto str_src = context->selected[0]->name;
-                std::strncpy(buffer, str_src, std::min(max_len, std::strlen(str_src)));
+            if (label == nullptr) {
+                reset_vars();
+                return display(false);
             }
 
-            else if (context->selected != nullptr && context->selected_num > 1) {
-                for (int k = 0; k < context->selected_num; k++) {
-                    if (k > 0)
-                        internal_::cat_str(buffer, "; ", max_len);
-                    const auto str_src = context->selected[k]->name;
-                    internal_::cat_str(buffer, str_src, max_len);
+            if (title == label) {
+                if (closed) {
+                    if (open != nullptr)
+                        *open = false;
+                    return display(false);
                 }
-            }
-        }
 
-        float alpha = 1.0f;
-        if (internal_::dir_only || context->selected_num > 1) {
-            ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
-            ImGui::BeginDisabled(true);
-            alpha = 0.5f;
-        }
+                if (reset) {
+                    if (size != nullptr) {
+                        ImGui::SetNextWindowSizeConstraints(*size, ImVec2(-1, -1));
+                        ImGui::SetNextWindowSize(*size, ImGuiCond_Appearing);
+                    }
+                    resizable = resize;
+                    reset     = false;
+                    ImGui::OpenPopup(title, ImGuiPopupFlags_NoReopen);
+                }
 
-        const bool      has_filters  = internal_::filters != nullptr;
-        constexpr float filters_size = 100.f;
+                open_ptr = open;
+                return display(true);
+            }
 
-        if (internal_::full_width_input(buffer, max_len, alpha, has_filters ? filters_size : 0.f)) {
-            internal_::FileContext::unselect_all(context);
-            context->peeked = false;
-        }
+            open_ptr  = open;
+            title     = label;
+            reset     = false;
+            closed    = false;
+            resizable = resize;
 
-        if (internal_::dir_only || context->selected_num > 1) {
-            ImGui::EndDisabled();
-            ImGui::PopStyleVar();
+            if (size != nullptr) {
+                ImGui::SetNextWindowSizeConstraints(*size, ImVec2(-1, -1));
+                ImGui::SetNextWindowSize(*size, ImGuiCond_Appearing);
+            }
+            ImGui::OpenPopup(title, ImGuiPopupFlags_NoReopen);
+            return display(true);
         }
 
-        if (has_filters && internal_::select_filter(context)) {
-            std::memset(context->buffer, 0, internal_::FileContext::buffer_size);
-            internal_::FileContext::reload(&context);
-            context->peeked = false;
-        }
+        static bool full_width_input(char *buffer, const std::size_t buffer_size, const float alpha = 1.0f,
+                                     const float padding_right = 0.f) {
+            bool       updated  = false;
+            const auto callback = [](ImGuiInputTextCallbackData *data) -> int {
+                if (data->EventFlag == ImGuiInputTextFlags_CallbackEdit)
+                    *static_cast<bool *>(data->UserData) = true;
+                return 0;
+            };
 
-        ImGui::Spacing();
+            const auto input_pos  = ImGui::GetCursorScreenPos();
+            const auto input_size = ImVec2(ImGui::GetContentRegionAvail().x - padding_right, ImGui::GetFrameHeight());
 
-        const bool can_save = context->read && (context->write || internal_::read_only) &&
-                              (internal_::accept_empty || std::strlen(buffer) > 0);
+            ImGui::SetNextItemWidth(input_size.x);
+            ImGui::InputText("##bordered_input", buffer, buffer_size, ImGuiInputTextFlags_CallbackEdit, callback,
+                             &updated);
 
-        bool create = false;
-        bool cancel = false;
-        bool accept = false;
+            ImGui::GetWindowDrawList()->AddRect(input_pos,
+                                                ImVec2(input_pos.x + input_size.x, input_pos.y + input_size.y),
+                                                IM_COL32(0, 0, 0, 90 * alpha));
 
-        if (!internal_::read_only) {
-            if (context->read && context->write)
-                internal_::buttons_dir(&create);
-            else
-              internal_::buttons_dir(nullptr);
-        } else {
-            ImGui::Dummy(ImVec2(1.0f, ImGui::GetFrameHeight()));
+            return updated;
         }
 
-        ImGui::Spacing();
+        void buttons_dir(bool *create) const {
+            const float offset  = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
+            const float ok_size = ImGui::CalcTextSize(labels.main_create).x + offset;
 
-        internal_::buttons_action(&cancel, can_save ? &accept : nullptr);
+            if (create == nullptr) {
+                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                ImGui::BeginDisabled(true);
+            }
 
-        if (cancel) {
-            *internal_::open_ptr = false;
-            internal_::closed    = true;
-            ImGui::CloseCurrentPopup();
-            ImGui::EndPopup();
-            if (context != nullptr) {
-                delete context;
-                context = nullptr;
+            if (ImGui::Button(labels.main_create, ImVec2(ok_size, 0))) {
+                if (create != nullptr)
+                    *create = true;
+            }
+
+            if (create == nullptr) {
+                ImGui::EndDisabled();
+                ImGui::PopStyleVar();
             }
-            return;
         }
 
-        static char new_name_buffer[128];
-        static bool allowed = false;
-        if (!internal_::read_only && create) {
-            allowed = false;
-            std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
-            ImGui::OpenPopup(internal_::labels.dir_title);
+        /**
+         * @return true if hidden files mode was toggled
+         */
+        bool toggle_hidden() {
+            ImGui::SameLine();
+            return ImGui::Checkbox(labels.main_hidden, &settings.show_hidden);
         }
 
-        const auto offset     = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
-        const auto title_size = ImGui::CalcTextSize(internal_::labels.dir_input).x + offset * 4;
+        /**
+         * @return true if recursive listing was toggled
+         */
+        bool toggle_tree() {
+            ImGui::SameLine();
+            return ImGui::Checkbox(labels.main_tree, &settings.recursive);
+        }
 
-        const auto center = ImGui::GetMainViewport()->GetCenter();
-        ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
-        ImGui::SetNextWindowSize(ImVec2(title_size, 0));
+        void buttons_action(bool *cancel, bool *accept) const {
+            const float offset  = ImGui::GetStyle().FramePadding.x * 2 + ImGui::GetStyle().ItemSpacing.x * 2;
+            const float spacing = ImGui::GetStyle().ItemSpacing.x;
 
-        if (!internal_::read_only &&
-            ImGui::BeginPopupModal(internal_::labels.dir_title, nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+            const float ok_size = ImGui::CalcTextSize(labels.main_accept).x + offset;
+            const float no_size = ImGui::CalcTextSize(labels.main_cancel).x + offset;
 
-            ImGui::Spacing();
-            ImGui::Spacing();
+            const float max_size = ok_size > no_size ? ok_size : no_size;
 
-            ImGui::Text("%s", internal_::labels.dir_input);
-            ImGui::Spacing();
 
-            if (internal_::full_width_input(new_name_buffer, sizeof(new_name_buffer))) {
-                allowed = std::strlen(new_name_buffer) > 0 &&
-                          !internal_::fs::exists(internal_::fs::absolute(*context->path / new_name_buffer));
-            }
+            const float available_width = ImGui::GetContentRegionMax().x;
 
-            ImGui::Spacing();
-            ImGui::Spacing();
+            ImGui::SetCursorPosX(available_width - (max_size + max_size + spacing));
 
-            const float ok_size = ImGui::CalcTextSize(internal_::labels.dir_accept).x + offset;
-            const float no_size = ImGui::CalcTextSize(internal_::labels.dir_cancel).x + offset;
-            const float free_w  = ImGui::GetContentRegionMax().x;
-            const float spacing = ImGui::GetStyle().ItemSpacing.x;
+            if (cancel == nullptr) {
+                ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
+                ImGui::BeginDisabled(true);
+            }
+            if (ImGui::Button(labels.main_cancel, ImVec2(max_size, 0))) {
+                if (cancel != nullptr)
+                    *cancel = true;
+            }
+            if (cancel == nullptr) {
+                ImGui::EndDisabled();
+                ImGui::PopStyleVar();
+            }
 
-            ImGui::SetCursorPosX(free_w - (ok_size + no_size + spacing));
+            ImGui::SameLine();
 
-            if (!allowed) {
+            if (accept == nullptr) {
                 ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0.5f);
                 ImGui::BeginDisabled(true);
             }
-            if (ImGui::Button(internal_::labels.dir_accept, ImVec2(ok_size, 0)) && allowed) {
-                allowed            = false;
-                const auto new_dir = internal_::fs::absolute(*context->path / new_name_buffer);
-                if (!internal_::fs::exists(new_dir) && internal_::fs::create_directory(new_dir)) {
-                    std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
-                    ImGui::CloseCurrentPopup();
-                    internal_::FileContext::reload(&context);
-                    context->peeked = false;
-                }
+            if (ImGui::Button(labels.main_accept, ImVec2(max_size, 0))) {
+                if (accept != nullptr)
+                    *accept = true;
             }
-            if (!allowed) {
+            if (accept == nullptr) {
                 ImGui::EndDisabled();
                 ImGui::PopStyleVar();
             }
+        }
 
-            ImGui::SameLine();
-            if (ImGui::Button(internal_::labels.dir_cancel, ImVec2(no_size, 0))) {
-                std::memset(new_name_buffer, 0, sizeof(new_name_buffer));
-                ImGui::CloseCurrentPopup();
-                allowed = false;
+        /**
+         * Draws timings and counters of the last load and frame over top right corner of the dialog.
+         */
+        void stats_overlay(const internal_::FileContext *context) const {
+#ifdef SIMPFP_STATS
+            if (!show_stats)
+                return;
+
+            const auto &st = context->stats;
+            const auto  ms = [](const std::uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+
+            char text[512];
+            std::snprintf(text, sizeof(text),
+                          "load    %9.2f ms\n"
+                          "scan    %9.2f ms\n"
+                          "scanned %9llu\n"
+                          "stat    %9llu\n"
+                          "memory  %9.1f KiB\n"
+                          "filter  %9.2f ms\n"
+                          "sort    %9.2f ms\n"
+                          "search  %9.2f ms\n"
+                          "poll    %9.2f ms\n"
+                          "frame   %9.2f ms\n"
+                          "format  %9.3f ms\n"
+                          "rows    %9llu / %llu",
+                          ms(st.load_ns), ms(st.scan_ns), static_cast<unsigned long long>(st.scanned),
+                          static_cast<unsigned long long>(st.stat_calls), static_cast<double>(st.bytes) / 1024.0,
+                          ms(st.filter_ns), ms(st.sort_ns), ms(st.search_ns), ms(st.poll_ns), ms(st.frame_ns),
+                          ms(st.format_ns), static_cast<unsigned long long>(st.formatted),
+                          static_cast<unsigned long long>(st.rows));
+
+            const auto   size    = ImGui::CalcTextSize(text);
+            const auto   padding = ImGui::GetStyle().WindowPadding;
+            const auto   window  = ImGui::GetWindowPos();
+            const float  right   = window.x + ImGui::GetWindowWidth() - padding.x;
+            const float  top     = window.y + ImGui::GetFrameHeight() + padding.y;
+            const ImVec2 min(right - size.x - padding.x * 2, top);
+
+            auto *draw = ImGui::GetWindowDrawList();
+            draw->AddRectFilled(min, ImVec2(right, top + size.y + padding.y * 2), IM_COL32(0, 0, 0, 180), 4.f);
+            draw->AddText(ImVec2(min.x + padding.x, top + padding.y), IM_COL32(255, 255, 255, 230), text);
+#else
+            (void) context;
+#endif
+        }
+
+        /**
+         * Draws recursive size of directory right after its name, file count and latest change in a tooltip.
+         */
+        void dir_totals(const std::uint32_t id) const {
+            const auto &listing = context->listing;
+            const auto  it      = context->usage.find(std::string_view(listing.name_of(id), listing.length_of(id)));
+            if (it == context->usage.end())
+                return;
+
+            const bool  hovered = ImGui::IsItemHovered();
+            const auto &usage   = it->second;
+
+            char size[24];
+            internal_::format_size(usage.size, true, size);
+            ImGui::SameLine(ImGui::GetContentRegionMax().x - ImGui::CalcTextSize(size).x);
+            ImGui::TextDisabled("%s", size);
+
+            if (hovered) {
+                char time[20];
+                internal_::format_time(usage.mtime, time);
+                ImGui::SetTooltip("%llu files, %s", static_cast<unsigned long long>(usage.files), time);
             }
-            ImGui::EndPopup();
         }
 
-        if (accept || (can_save && double_click)) {
-            context->accepted = true;
-            ImGui::EndPopup();
-            return;
+        /**
+         * Draws metadata and preview of given file, requesting the preview if it is not shown yet.
+         */
+        void preview_pane(const std::uint32_t id, const float width, const float height) {
+            ImGui::BeginChild("##region_preview", ImVec2(width, height), ImGuiChildFlags_Borders,
+                              ImGuiWindowFlags_HorizontalScrollbar);
+
+            if (id == UINT32_MAX) {
+                previewer.clear();
+                ImGui::EndChild();
+                return;
+            }
+
+            const auto &listing = context->listing;
+            const auto &cells   = context->cells.get(listing, id, human_size);
+
+            previewer.request(internal_::FileContext::path_of(context, id).native(), listing.size[id],
+                              listing.mtime[id]);
+            previewer.poll();
+
+            ImGui::TextUnformatted(listing.name_of(id));
+            ImGui::TextDisabled("%s  %s  %c%c", cells.size, cells.time, listing.is(id, ENTRY_READ) ? 'r' : '-',
+                                listing.is(id, ENTRY_WRITE) ? 'w' : '-');
+            ImGui::Separator();
+
+            if (const auto &preview = previewer.shown; preview == nullptr)
+                ImGui::TextDisabled("%s", labels.loading);
+            else if (preview->failed || preview->text.empty())
+                ImGui::TextDisabled("%s", labels.no_preview);
+            else {
+                ImGui::TextUnformatted(preview->text.data(), preview->text.data() + preview->text.size());
+                if (preview->truncated)
+                    ImGui::TextDisabled("...");
+            }
+
+            ImGui::EndChild();
         }
 
-        ImGui::EndPopup();
+        bool select_filter(internal_::FileContext *context, const float alpha = 1.f) const {
+            ImGui::SameLine();
+            constexpr float field_size      = 100.f;
+            const float     available_width = ImGui::GetContentRegionMax().x;
+            const float     spacing         = ImGui::GetStyle().ItemSpacing.x;
 
-        if (internal_::open_ptr != nullptr && !*internal_::open_ptr) {
-            internal_::closed = true;
-            if (context != nullptr) {
-                delete context;
-                context = nullptr;
+            ImGui::SetCursorPosX(available_width - (field_size) + spacing);
+            ImGui::PushItemWidth(field_size - spacing);
+
+            const auto input_pos  = ImGui::GetCursorScreenPos();
+            const auto input_size = ImVec2(field_size - spacing, ImGui::GetFrameHeight());
+
+            const auto prev_index = context->filter_idx;
+
+            if (ImGui::BeginCombo("##filters", settings.filters[context->filter_idx],
+                                  ImGuiComboFlags_HeightRegular)) {
+                for (int n = 0; settings.filters[n] != nullptr; n++) {
+                    const bool is_selected = (context->filter_idx == n);
+                    ImGui::PushID(n);
+                    if (ImGui::Selectable(settings.filters[n], is_selected))
+                        context->filter_idx = n;
+                    if (is_selected)
+                        ImGui::SetItemDefaultFocus();
+                    ImGui::PopID();
+                }
+                ImGui::EndCombo();
             }
+            ImGui::PopItemWidth();
+
+            ImGui::GetWindowDrawList()->AddRect(input_pos,
+                                                ImVec2(input_pos.x + input_size.x, input_pos.y + input_size.y),
+                                                IM_COL32(0, 0, 0, 90 * alpha));
+
+            return context->filter_idx != prev_index;
         }
-    }
 
-    inline void UnselectAll() {
-        if (context == nullptr)
-            return;
-        if (context->selected != nullptr)
-            delete[] context->selected;
-        context->selected = nullptr;
-        context->accepted = false;
-        context->peeked   = true;
-    }
+        /**
+         * Reports selected files, or typed file name if there is no multi-selection.
+         */
+        std::size_t report(const std::function<bool(const char *path)> &callback) const {
+            if (context->selected.size() > 1)
+                return internal_::FileContext::for_each_selected(context, callback);
 
-    inline void ResetBuffer() {
-        if (context == nullptr)
-            return;
-        std::memset(context->buffer, 0, internal_::FileContext::buffer_size);
-        context->accepted = false;
-        context->peeked   = true;
-    }
+            if (context->buffer != nullptr && std::strlen(context->buffer) > 0) {
+                callback((*context->path / context->buffer).c_str());
+                return 1;
+            }
 
-    inline void Reload() {
-        if (context == nullptr)
-            return;
-        std::memset(context->buffer, 0, internal_::FileContext::buffer_size);
-        internal_::FileContext::reload(&context);
-        context->accepted = false;
-        context->peeked   = true;
-    }
+            if (!accept_empty)
+                return 0;
 
-    inline long CountSelected() {
-        if (context == nullptr || context->selected == nullptr)
-            return 0;
-        return context->selected_num;
-    }
+            callback(context->path->c_str());
+            return 1;
+        }
 
-    inline const char *CurrentPath() {
-        if (context == nullptr || context->path == nullptr)
-            return nullptr;
-        return context->path->c_str();
-    }
+        /**
+         * Same paths as report() gives, packed into <b>batch</b>.
+         */
+        PathSpan collect(Batch &batch) const {
+            if (context->selected.size() > 1)
+                return internal_::FileContext::collect(context, batch.block, batch.views);
 
-    inline bool FilterSelected(int *filter_idx) {
-        if (context == nullptr || internal_::filters == nullptr)
-            return false;
-        *filter_idx = context->filter_idx;
-        return true;
-    }
+            if (std::strlen(context->buffer) > 0)
+                return internal_::FileContext::collect(context, batch.block, batch.views, { context->buffer });
 
-    inline bool PeekSelected(char *buffer_out, const std::size_t size) {
-        if (context == nullptr || context->peeked)
-            return false;
+            batch.views.clear();
+            if (!accept_empty)
+                return {};
 
-        context->peeked = true;
+            batch.block = context->path->native();
+            batch.views.emplace_back(batch.block);
+            return { batch.views.data(), batch.views.size() };
+        }
 
-        if (context->selected == nullptr || context->selected_num <= 0) {
-            context->peeked = true;
+        /**
+         * Runs callbacks for what happened during the frame. Any of them may close or reopen the dialog.
+         */
+        void notify(const bool accepted) {
+            if (context != nullptr && last_dir != context->path->native()) {
+                // entering a directory starts with empty selection
+                last_dir          = context->path->native();
+                selection_changed = true;
+                if (on_directory)
+                    on_directory(last_dir.c_str());
+            }
 
-            if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
-                std::memset(buffer_out, 0, size);
-                std::strncpy(buffer_out, context->path->c_str(), size);
-                return true;
+            if (context != nullptr && selection_changed) {
+                selection_changed = false;
+                if (on_selection)
+                    on_selection(collect(event_paths));
             }
 
-            std::memset(buffer_out, 0, size);
-            std::strncpy(buffer_out, internal_::fs::absolute(*context->path / context->buffer).c_str(), size);
-            return true;
+            if (context != nullptr && accepted && on_accepted)
+                on_accepted(collect(event_paths));
         }
+    };
 
-        const auto &selected = context->selected[0];
-        if (selected == nullptr) {
-            return false;
+    namespace internal_ {
+        /**
+         * Instance behind the free functions, never destroyed so it can't outlive the worker pool.
+         */
+        inline FileDialog &dialog() {
+            static auto *instance = new FileDialog();
+            return *instance;
         }
+    } // namespace internal_
 
-        if (context->selected_num == 1) {
-            std::memset(buffer_out, 0, size);
-            std::strncpy(buffer_out, internal_::fs::absolute(selected->path->parent_path() / context->buffer).c_str(),
-                         size);
-            return true;
-        }
+    inline void OpenFileDialog(const char *title, const char *default_path, const char **filters, const Labels *labels,
+                               const bool read_only, const bool accept_empty, const bool dir_only) {
+        internal_::dialog().Open(title, default_path, filters, labels, read_only, accept_empty, dir_only);
+    }
 
-        std::memset(buffer_out, 0, size);
-        std::strncpy(buffer_out, internal_::fs::absolute(*selected->path).c_str(), size);
-        return true;
+    inline bool FileDialogOpen() {
+        return internal_::dialog().IsOpen();
     }
 
-    inline bool PeekSelected(char *buffer_out, const std::size_t size, const std::size_t index) {
-        static std::size_t last_index = 0;
-        internal_::single             = false;
+    inline void CloseFileDialog() {
+        internal_::dialog().Close();
+    }
 
-        if (index < last_index || context == nullptr || context->peeked) {
-            if (context != nullptr)
-                context->peeked = true;
-            last_index = 0;
-            return false;
-        }
+    inline bool ShowFileDialog(const char *label, bool *open) {
+        return internal_::dialog().Show(label, open);
+    }
 
-        last_index = index;
-        if (context->selected == nullptr || context->selected_num <= 0 || context->selected_num <= index) {
-            context->peeked = true;
-            last_index      = 0;
+    inline bool ShowFileDialog(const char *label, bool *open, const ImVec2 &size, const bool resize) {
+        return internal_::dialog().Show(label, open, size, resize);
+    }
 
-            if (index == 0) {
+    inline void EndFileDialog() {
+        internal_::dialog().End();
+    }
 
-                if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
-                    std::memset(buffer_out, 0, size);
-                    std::strncpy(buffer_out, context->path->c_str(), size);
-                    return true;
-                }
+    inline void UnselectAll() {
+        internal_::dialog().UnselectAll();
+    }
 
-                std::memset(buffer_out, 0, size);
-                std::strncpy(buffer_out, internal_::fs::absolute(*context->path / context->buffer).c_str(), size);
-                return true;
-            }
-            return false;
-        }
+    inline void SelectAll() {
+        internal_::dialog().SelectAll();
+    }
 
-        const auto &selected = context->selected[index];
-        if (selected == nullptr) {
-            context->peeked = true;
-            last_index      = 0;
-            return false;
-        }
+    inline void InvertSelection() {
+        internal_::dialog().InvertSelection();
+    }
 
-        if (index >= context->selected_num - 1) {
-            context->peeked = true;
-            last_index      = 0;
-        }
+    inline long SelectMatching(const char *glob) {
+        return internal_::dialog().SelectMatching(glob);
+    }
 
-        if (context->selected_num == 1) {
-            context->peeked = true;
-            last_index      = 0;
-            std::memset(buffer_out, 0, size);
-            std::strncpy(buffer_out, internal_::fs::absolute(selected->path->parent_path() / context->buffer).c_str(),
-                         size);
-            return true;
-        }
+    inline void Search(const char *query) {
+        internal_::dialog().Search(query);
+    }
 
-        std::memset(buffer_out, 0, size);
-        std::strncpy(buffer_out, internal_::fs::absolute(*selected->path).c_str(), size);
-        return true;
+    inline void ResetBuffer() {
+        internal_::dialog().ResetBuffer();
     }
 
-    inline bool FileAccepted(char *buffer_out, const std::size_t size, const std::size_t index) {
-        static std::size_t last_index = 0;
-        internal_::single             = false;
+    inline void Reload() {
+        internal_::dialog().Reload();
+    }
 
-        if (index < last_index || context == nullptr || !context->accepted) {
-            if (context != nullptr)
-                context->accepted = false;
-            last_index = 0;
-            return false;
-        }
+    inline void FilterIgnoreCase(const bool enable) {
+        internal_::dialog().FilterIgnoreCase(enable);
+    }
 
-        last_index = index;
+    inline void ShowHiddenFiles(const bool enable) {
+        internal_::dialog().ShowHiddenFiles(enable);
+    }
 
-        if (context->selected == nullptr || context->selected_num <= 0 || context->selected_num <= index) {
-            context->accepted = false;
-            last_index        = 0;
+    inline void RecursiveListing(const bool enable, const int max_depth) {
+        internal_::dialog().RecursiveListing(enable, max_depth);
+    }
 
-            if (index == 0) {
+    inline void HumanReadableSize(const bool enable) {
+        internal_::dialog().HumanReadableSize(enable);
+    }
 
-                if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
-                    if (internal_::accept_empty) {
-                        std::memset(buffer_out, 0, size);
-                        std::strncpy(buffer_out, context->path->c_str(), size);
-                        return true;
-                    }
-                    return false;
-                }
+    inline void NaturalSort(const bool enable) {
+        internal_::dialog().NaturalSort(enable);
+    }
 
-                std::memset(buffer_out, 0, size);
-                std::strncpy(buffer_out, internal_::fs::absolute(*context->path / context->buffer).c_str(), size);
-                return true;
-            }
-            return false;
-        }
+    inline void WatchDirectory(const bool enable) {
+        internal_::dialog().WatchDirectory(enable);
+    }
 
-        const auto &selected = context->selected[index];
-        if (selected == nullptr) {
-            context->accepted = false;
-            last_index        = 0;
-            return false;
-        }
+    inline PhaseStats FileDialogStats() {
+        return internal_::dialog().Stats();
+    }
 
-        if (context->selected_num == 1) {
-            context->accepted = false;
-            last_index        = 0;
+    inline void ShowStatsOverlay(const bool enable) {
+        internal_::dialog().ShowStatsOverlay(enable);
+    }
 
-            std::memset(buffer_out, 0, size);
-            std::strncpy(buffer_out, internal_::fs::absolute(selected->path->parent_path() / context->buffer).c_str(),
-                         size);
-            return true;
-        }
+    inline void ShowPreviewPane(const bool enable) {
+        internal_::dialog().ShowPreviewPane(enable);
+    }
 
-        std::memset(buffer_out, 0, size);
-        std::strncpy(buffer_out, internal_::fs::absolute(*selected->path).c_str(), size);
+    inline void DirectorySizes(const bool enable) {
+        internal_::dialog().DirectorySizes(enable);
+    }
 
-        if (index >= context->selected_num - 1) {
-            context->accepted = false;
-            last_index        = 0;
-        }
+    inline void PrefetchListings(const bool enable) {
+        internal_::dialog().PrefetchListings(enable);
+    }
+
+    inline long CountSelected() {
+        return internal_::dialog().CountSelected();
+    }
+
+    inline const char *CurrentPath() {
+        return internal_::dialog().CurrentPath();
+    }
+
+    inline bool FilterSelected(int *filter_idx) {
+        return internal_::dialog().FilterSelected(filter_idx);
+    }
 
-        return true;
+    inline bool PeekSelected(char *buffer_out, const std::size_t size) {
+        return internal_::dialog().PeekSelected(buffer_out, size);
+    }
+
+    inline bool PeekSelected(char *buffer_out, const std::size_t size, const std::size_t index) {
+        return internal_::dialog().PeekSelected(buffer_out, size, index);
     }
 
     inline bool FileAccepted(char *buffer_out, const std::size_t size) {
-        if (context == nullptr || !context->accepted)
-            return false;
+        return internal_::dialog().FileAccepted(buffer_out, size);
+    }
 
-        context->accepted = false;
+    inline bool FileAccepted(char *buffer_out, const std::size_t size, const std::size_t index) {
+        return internal_::dialog().FileAccepted(buffer_out, size, index);
+    }
 
-        if (context->selected == nullptr || context->selected_num <= 0) {
-            if (context->buffer == nullptr || std::strlen(context->buffer) <= 0) {
-                if (internal_::accept_empty) {
-                    std::memset(buffer_out, 0, size);
-                    std::strncpy(buffer_out, context->path->c_str(), size);
-                    return true;
-                }
-                return false;
-            }
+    inline std::size_t ForEachAccepted(const std::function<bool(const char *path)> &callback) {
+        return internal_::dialog().ForEachAccepted(callback);
+    }
 
-            std::memset(buffer_out, 0, size);
-            std::strncpy(buffer_out, internal_::fs::absolute(*context->path / context->buffer).c_str(), size);
-            return true;
-        }
+    inline std::size_t ForEachSelected(const std::function<bool(const char *path)> &callback) {
+        return internal_::dialog().ForEachSelected(callback);
+    }
+
+    inline PathSpan AcceptedPaths() {
+        return internal_::dialog().AcceptedPaths();
+    }
+
+    inline PathSpan SelectedPaths() {
+        return internal_::dialog().SelectedPaths();
+    }
+
+    inline void OnSelectionChanged(std::function<void(PathSpan paths)> callback) {
+        internal_::dialog().OnSelectionChanged(std::move(callback));
+    }
+
+    inline void OnFileAccepted(std::function<void(PathSpan paths)> callback) {
+        internal_::dialog().OnFileAccepted(std::move(callback));
+    }
 
-        std::memset(buffer_out, 0, size);
-        std::strncpy(buffer_out,
-                     internal_::fs::absolute(context->selected[0]->path->parent_path() / context->buffer).c_str(),
-                     size);
-        return true;
+    inline void OnDirectoryChanged(std::function<void(const char *path)> callback) {
+        internal_::dialog().OnDirectoryChanged(std::move(callback));
     }
 
 } // namespace simpfp
@@ -0,0 +1,4108 @@
+//
+// Created by xd on 02/02/25.
+//
+// ReSharper disable CppDFANullDereference
+//
+// Headless part of simpfp: directory listing, filters, sorting, search and selection.
+// Does not depend on ImGui, see DirectoryModel.
+//
+
+#ifndef SIMPFP_CORE_H
+#define SIMPFP_CORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string.h>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+namespace simpfp {
+
+    /**
+     * Read-only view over a batch of absolute paths, every one also terminated with '\0'.
+     * Valid until the batch is requested again from the same owner (at most once per frame).
+     * <br/>Plain pointer and size, since headers are usable from C++17; converts to std::span in C++20.
+     */
+    struct PathSpan {
+        const std::string_view *data = nullptr;
+        std::size_t             size = 0;
+
+        const std::string_view *begin() const {
+            return data;
+        }
+
+        const std::string_view *end() const {
+            return data + size;
+        }
+
+        const std::string_view &operator[](const std::size_t index) const {
+            return data[index];
+        }
+
+        bool empty() const {
+            return size == 0;
+        }
+
+#if __cplusplus >= 202002L
+        operator std::span<const std::string_view>() const {
+            return { data, size };
+        }
+#endif
+    };
+
+    /**
+     * Recursive totals of a directory, symbolic links to directories are not followed.
+     */
+    struct DirUsage {
+        std::uint64_t size  = 0; // of all files
+        std::uint64_t files = 0;
+        std::int64_t  mtime = 0; // latest modification of any file, unix epoch, milliseconds
+    };
+
+    struct CacheStats {
+        std::size_t hits    = 0;
+        std::size_t misses  = 0;
+        std::size_t entries = 0;
+        std::size_t bytes   = 0;
+    };
+
+    /**
+     * Where the time goes, durations in nanoseconds. Collected only when compiled with SIMPFP_STATS,
+     * otherwise instrumentation compiles to nothing and everything stays zero.
+     */
+    struct PhaseStats {
+        // last directory load
+        std::uint64_t load_ns    = 0; // from request until the whole listing was merged
+        std::uint64_t scan_ns    = 0; // enumeration on background threads (readdir, stat)
+        std::uint64_t scanned    = 0; // entries enumerated
+        std::uint64_t stat_calls = 0; // stat calls issued by enumeration
+        std::uint64_t bytes      = 0; // memory held by the listing
+
+        // last operation of each kind
+        std::uint64_t filter_ns = 0; // filtering, including re-sort
+        std::uint64_t sort_ns   = 0;
+        std::uint64_t search_ns = 0;
+
+        // last frame, dialog only
+        std::uint64_t poll_ns   = 0; // merging entries loaded in background
+        std::uint64_t frame_ns  = 0; // whole dialog
+        std::uint64_t format_ns = 0; // formatting of sizes and dates
+        std::uint64_t formatted = 0; // rows formatted, others came from cache
+        std::uint64_t rows      = 0; // rows drawn
+    };
+
+    /**
+     * Limits cache of recently visited directory listings, shared by all models, zero disables caching.
+     * @param max_entries number of directories kept, 16 by default
+     * @param max_bytes memory budget of all cached listings, 64 MiB by default
+     */
+    void ListingCacheCapacity(std::size_t max_entries, std::size_t max_bytes);
+    CacheStats ListingCacheStats();
+
+    /**
+     * @param max_bytes memory budget of recently viewed file previews, shared by all dialogs, 8 MiB by default
+     */
+    void PreviewCacheCapacity(std::size_t max_bytes);
+
+    namespace internal_ {
+        namespace fs = std::filesystem;
+
+#define SORT_NONE 0
+
+#define SORT_NAME 1
+#define SORT_SIZE 2
+#define SORT_TYPE 3
+#define SORT_TIME 4
+
+#define SORT_ASC 1
+#define SORT_DSC 2
+
+#define ENTRY_DIR    1
+#define ENTRY_READ   2
+#define ENTRY_WRITE  4
+#define ENTRY_PARENT 8
+
+#ifdef SIMPFP_STATS
+#define SIMPFP_STAT(...) __VA_ARGS__
+#else
+#define SIMPFP_STAT(...)
+#endif
+        /**
+         * Glob pattern set compiled once and matched directly against raw name bytes.
+         * Supports '*', '?', '[...]' classes (ranges, '!' or '^' negation), '{a,b}' alternation,
+         * '\' escapes and ';' separated pattern sets, ie: "*.cpp;*.h".
+         * Empty pattern, "*" and " " match everything.
+         */
+        struct Glob {
+            static constexpr std::size_t max_patterns = 256;
+
+            bool compile(const char *glob, const bool ignore_case = false) {
+                patterns.clear();
+                literals.clear();
+                classes.clear();
+                icase     = ignore_case;
+                match_all = false;
+
+                if (glob == nullptr || *glob == '\0' || std::strcmp(glob, "*") == 0 || std::strcmp(glob, " ") == 0) {
+                    match_all = true;
+                    return true;
+                }
+
+                std::vector<std::string> expanded;
+                for (const auto &part : split(glob))
+                    expand(part, expanded);
+
+                for (const auto &pattern : expanded) {
+                    if (!add(pattern))
+                        return false;
+                    if (match_all)
+                        break;
+                }
+                return true;
+            }
+
+            bool match(const char *name) const {
+                return match(name, std::strlen(name));
+            }
+
+            bool match(const char *name, const std::size_t len) const {
+                if (match_all)
+                    return true;
+                for (const auto &pattern : patterns)
+                    if (match(pattern, name, len))
+                        return true;
+                return false;
+            }
+
+            bool matches_all() const {
+                return match_all;
+            }
+
+        private:
+            enum : std::uint8_t { OP_LITERAL, OP_ANY, OP_STAR, OP_CLASS };
+            enum : std::uint8_t { KIND_GENERAL, KIND_EXACT, KIND_SUFFIX };
+
+            struct Op {
+                std::uint8_t  code   = OP_LITERAL;
+                std::uint32_t offset = 0; // literal offset in literals, or index in classes
+                std::uint32_t length = 0; // literal length
+            };
+
+            struct Pattern {
+                std::vector<Op> ops;
+                std::uint8_t    kind   = KIND_GENERAL;
+                std::uint32_t   offset = 0; // fast path literal
+                std::uint32_t   length = 0;
+            };
+
+            struct Class {
+                std::uint64_t bits[4] = {};
+
+                void set(const unsigned char c) {
+                    bits[c >> 6] |= std::uint64_t{ 1 } << (c & 63);
+                }
+
+                bool test(const unsigned char c) const {
+                    return (bits[c >> 6] >> (c & 63)) & 1;
+                }
+            };
+
+            std::vector<Pattern> patterns;
+            std::vector<Class>   classes;
+            std::string          literals;
+            bool                 icase     = false;
+            bool                 match_all = false;
+
+            static unsigned char fold(const unsigned char c) {
+                return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+            }
+
+            unsigned char folded(const char c) const {
+                return icase ? fold(static_cast<unsigned char>(c)) : static_cast<unsigned char>(c);
+            }
+
+            bool equal(const char *name, const std::uint32_t offset, const std::uint32_t length) const {
+                const char *lit = literals.data() + offset;
+                if (!icase)
+                    return std::memcmp(name, lit, length) == 0;
+                for (std::uint32_t i = 0; i < length; i++)
+                    if (fold(static_cast<unsigned char>(name[i])) != static_cast<unsigned char>(lit[i]))
+                        return false;
+                return true;
+            }
+
+            /**
+             * Splits pattern set on top-level ';', separators inside of '[...]' or '{...}' are kept.
+             */
+            static std::vector<std::string> split(const char *glob) {
+                std::vector<std::string> parts(1);
+                int                      braces = 0;
+                bool                     square = false;
+                for (const char *c = glob; *c != '\0'; c++) {
+                    if (*c == '\\' && c[1] != '\0') {
+                        parts.back() += *c++;
+                        parts.back() += *c;
+                        continue;
+                    }
+                    if (!square && *c == '[')
+                        square = true;
+                    else if (square && *c == ']')
+                        square = false;
+                    else if (!square && *c == '{')
+                        braces++;
+                    else if (!square && *c == '}' && braces > 0)
+                        braces--;
+                    else if (!square && braces == 0 && *c == ';') {
+                        parts.emplace_back();
+                        continue;
+                    }
+                    parts.back() += *c;
+                }
+                return parts;
+            }
+
+            /**
+             * Expands first top-level '{a,b,...}' group recursively, unbalanced braces are left literal.
+             */
+            static void expand(const std::string &pattern, std::vector<std::string> &out) {
+                if (out.size() >= max_patterns)
+                    return;
+
+                std::size_t open  = std::string::npos;
+                int         depth = 0;
+                bool        sq    = false;
+                std::vector<std::size_t> commas;
+
+                for (std::size_t i = 0; i < pattern.size(); i++) {
+                    const char c = pattern[i];
+                    if (c == '\\') {
+                        i++;
+                        continue;
+                    }
+                    if (sq) {
+                        sq = c != ']';
+                        continue;
+                    }
+                    if (c == '[') {
+                        sq = true;
+                    }
+                    else if (c == '{') {
+                        if (depth++ == 0)
+                            open = i;
+                    }
+                    else if (c == ',' && depth == 1) {
+                        commas.push_back(i);
+                    }
+                    else if (c == '}' && depth > 0 && --depth == 0) {
+                        const auto head = pattern.substr(0, open);
+                        const auto tail = pattern.substr(i + 1);
+
+                        std::size_t from = open + 1;
+                        commas.push_back(i);
+                        for (const auto to : commas) {
+                            expand(head + pattern.substr(from, to - from) + tail, out);
+                            from = to + 1;
+                        }
+                        return;
+                    }
+                }
+
+                if (out.size() < max_patterns)
+                    out.push_back(pattern);
+            }
+
+            bool add(const std::string &glob) {
+                Pattern pattern;
+
+                const auto literal = [&](const char c) {
+                    const auto folded = static_cast<char>(icase ? fold(static_cast<unsigned char>(c)) : c);
+                    if (pattern.ops.empty() || pattern.ops.back().code != OP_LITERAL) {
+                        Op op;
+                        op.offset = static_cast<std::uint32_t>(literals.size());
+                        pattern.ops.push_back(op);
+                    }
+                    literals += folded;
+                    pattern.ops.back().length++;
+                };
+
+                for (std::size_t i = 0; i < glob.size(); i++) {
+                    const char c = glob[i];
+
+                    if (c == '\\' && i + 1 < glob.size()) {
+                        literal(glob[++i]);
+                    }
+                    else if (c == '*') {
+                        if (pattern.ops.empty() || pattern.ops.back().code != OP_STAR) {
+                            Op op;
+                            op.code = OP_STAR;
+                            pattern.ops.push_back(op);
+                        }
+                    }
+                    else if (c == '?') {
+                        Op op;
+                        op.code = OP_ANY;
+                        pattern.ops.push_back(op);
+                    }
+                    else if (c == '[') {
+                        std::size_t j      = i + 1;
+                        const bool  negate = j < glob.size() && (glob[j] == '!' || glob[j] == '^');
+                        if (negate)
+                            j++;
+
+                        Class cls;
+                        bool  closed = false;
+                        for (bool first = true; j < glob.size(); j++, first = false) {
+                            if (glob[j] == ']' && !first) {
+                                closed = true;
+                                break;
+                            }
+                            auto lo = static_cast<unsigned char>(glob[j]);
+                            if (lo == '\\' && j + 1 < glob.size())
+                                lo = static_cast<unsigned char>(glob[++j]);
+                            auto hi = lo;
+                            if (j + 2 < glob.size() && glob[j + 1] == '-' && glob[j + 2] != ']') {
+                                hi = static_cast<unsigned char>(glob[j + 2]);
+                                j += 2;
+                            }
+                            // folded like literals, so that negated classes exclude both cases
+                            for (unsigned v = lo; v <= hi; v++)
+                                cls.set(icase ? fold(static_cast<unsigned char>(v)) : static_cast<unsigned char>(v));
+                        }
+
+                        if (!closed) {
+                            literal(c);
+                            continue;
+                        }
+
+                        if (negate)
+                            for (auto &bits : cls.bits)
+                                bits = ~bits;
+
+                        Op op;
+                        op.code   = OP_CLASS;
+                        op.offset = static_cast<std::uint32_t>(classes.size());
+                        classes.push_back(cls);
+                        pattern.ops.push_back(op);
+                        i = j;
+                    }
+                    else {
+                        literal(c);
+                    }
+                }
+
+                const auto &ops = pattern.ops;
+                if (ops.size() == 1 && ops[0].code == OP_STAR) {
+                    match_all = true;
+                    return true;
+                }
+                if (ops.size() == 1 && ops[0].code == OP_LITERAL) {
+                    pattern.kind   = KIND_EXACT;
+                    pattern.offset = ops[0].offset;
+                    pattern.length = ops[0].length;
+                }
+                else if (ops.size() == 2 && ops[0].code == OP_STAR && ops[1].code == OP_LITERAL) {
+                    pattern.kind   = KIND_SUFFIX;
+                    pattern.offset = ops[1].offset;
+                    pattern.length = ops[1].length;
+                }
+
+                patterns.push_back(std::move(pattern));
+                return true;
+            }
+
+            bool match(const Pattern &pattern, const char *name, const std::size_t len) const {
+                if (pattern.kind == KIND_SUFFIX)
+                    return len >= pattern.length && equal(name + len - pattern.length, pattern.offset, pattern.length);
+                if (pattern.kind == KIND_EXACT)
+                    return len == pattern.length && equal(name, pattern.offset, pattern.length);
+
+                const auto &ops = pattern.ops;
+                std::size_t op  = 0;
+                std::size_t pos = 0;
+
+                std::size_t star_op  = SIZE_MAX;
+                std::size_t star_pos = 0;
+
+                for (;;) {
+                    if (op == ops.size() && pos == len)
+                        return true;
+
+                    if (op < ops.size()) {
+                        const auto &cur = ops[op];
+                        if (cur.code == OP_STAR) {
+                            star_op  = op++;
+                            star_pos = pos;
+                            continue;
+                        }
+                        if (cur.code == OP_LITERAL && pos + cur.length <= len &&
+                            equal(name + pos, cur.offset, cur.length)) {
+                            pos += cur.length;
+                            op++;
+                            continue;
+                        }
+                        if (cur.code == OP_ANY && pos < len) {
+                            pos++;
+                            op++;
+                            continue;
+                        }
+                        if (cur.code == OP_CLASS && pos < len && classes[cur.offset].test(folded(name[pos]))) {
+                            pos++;
+                            op++;
+                            continue;
+                        }
+                    }
+
+                    if (star_op == SIZE_MAX || star_pos >= len)
+                        return false;
+
+                    pos = ++star_pos;
+                    op  = star_op + 1;
+                }
+            }
+        };
+
+        /**
+         * Options of a directory model, owned by whoever drives it (the dialog or a DirectoryModel)
+         * and shared by every context loaded through it.
+         */
+        struct Settings {
+            const char **filters      = nullptr;
+            bool         filter_icase = false;
+            bool         show_hidden  = true;
+            bool         natural_sort = false;
+            bool         watch_dir    = false;
+            bool         recursive    = false;
+            bool         read_only    = false;
+            bool         dir_sizes    = false;
+            bool         prefetch     = true;
+            int          max_depth    = 32;
+            const char  *selected     = "files selected"; // summary of multi-selection
+
+            /**
+             * Compiles current filters once, recompiled only when filters array or case mode changes.
+             */
+            void compile_filters() {
+                globs.clear();
+                globs_source = filters;
+                if (filters == nullptr)
+                    return;
+                for (int i = 0; filters[i] != nullptr; i++) {
+                    const auto glob = std::make_shared<Glob>();
+                    glob->compile(filters[i], filter_icase);
+                    globs.push_back(glob);
+                }
+            }
+
+            /**
+             * @return compiled glob for given filter index, or nullptr if nothing should be filtered out
+             */
+            std::shared_ptr<const Glob> filter_glob(const int filter_idx) {
+                if (filters == nullptr || filter_idx < 0)
+                    return nullptr;
+                if (globs_source != filters)
+                    compile_filters();
+                if (filter_idx >= static_cast<int>(globs.size()) || globs[filter_idx]->matches_all())
+                    return nullptr;
+                return globs[filter_idx];
+            }
+
+        private:
+            const char                             **globs_source = nullptr;
+            std::vector<std::shared_ptr<const Glob>> globs;
+        };
+
+        /**
+         * Effective access check of a directory, including search permission needed to enter it.
+         * Answered by the kernel from metadata alone (honours ACLs and read-only mounts), nothing is written.
+         */
+        inline bool can_access(const fs::path &dir, const bool write) {
+#if defined(__unix__) || defined(__APPLE__)
+            return ::faccessat(AT_FDCWD, dir.c_str(), (write ? W_OK : R_OK) | X_OK, AT_EACCESS) == 0;
+#else
+            std::error_code ec;
+            const auto      perms = fs::status(dir, ec).permissions();
+            if (ec)
+                return false;
+
+            const auto mask = write ? fs::perms::owner_write | fs::perms::group_write | fs::perms::others_write
+                                    : fs::perms::owner_read | fs::perms::group_read | fs::perms::others_read;
+            return (perms & mask) != fs::perms::none;
+#endif
+        }
+
+        inline bool can_write(const fs::path &dir) {
+            return can_access(dir, true);
+        }
+
+        inline bool can_read(const fs::path &dir) {
+            return can_access(dir, false);
+        }
+
+        /**
+         * Last component of a relative path, as listed in recursive mode.
+         */
+        inline const char *basename_of(const char *name) {
+            const char *sep = std::strrchr(name, static_cast<char>(fs::path::preferred_separator));
+            return sep == nullptr ? name : sep + 1;
+        }
+
+        /**
+         * Same semantics as fs::path::extension(), without constructing a path.
+         */
+        inline const char *extension_of(const char *name) {
+            name            = basename_of(name);
+            const char *dot = std::strrchr(name, '.');
+            return (dot == nullptr || dot == name) ? "" : dot;
+        }
+
+        /**
+         * @return absolute path to open, resolved once here so that results never need the working directory
+         */
+        inline fs::path load_path(const char *file) {
+            if (file == nullptr)
+                return fs::current_path();
+            std::error_code ec;
+            const auto      path = fs::absolute(fs::path(file), ec);
+            return !ec && fs::exists(path) ? path : fs::current_path();
+        }
+
+        /**
+         * Seconds since unix epoch for a broken-down civil time, no timezone involved.
+         */
+        inline std::int64_t civil_to_unix(std::int64_t y, const unsigned m, const unsigned d, const unsigned hh,
+                                          const unsigned mm, const unsigned ss) {
+            y -= m <= 2;
+            const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+            const auto         yoe = static_cast<unsigned>(y - era * 400);
+            const unsigned     doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+            const unsigned     doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            const std::int64_t day = era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+            return day * 86400 + hh * 3600 + mm * 60 + ss;
+        }
+
+        /**
+         * Offset of local time from UTC at given moment, memoized per day so bulk formatting
+         * hits libc only once for every distinct day (DST changes within a day are not tracked).
+         */
+        inline std::int64_t utc_offset(const std::int64_t unix_s) {
+            struct Slot {
+                std::int64_t day    = INT64_MIN;
+                std::int64_t offset = 0;
+            };
+            static thread_local Slot slots[64];
+
+            const std::int64_t day  = unix_s >= 0 ? unix_s / 86400 : (unix_s - 86399) / 86400;
+            Slot              &slot = slots[static_cast<std::uint64_t>(day) & 63];
+            if (slot.day == day)
+                return slot.offset;
+
+            const auto tt = static_cast<std::time_t>(unix_s);
+            std::tm    tm{};
+#ifdef _WIN32
+            localtime_s(&tm, &tt);
+#else
+            localtime_r(&tt, &tm);
+#endif
+            slot.day    = day;
+            slot.offset = civil_to_unix(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+                                        tm.tm_sec) - unix_s;
+            return slot.offset;
+        }
+
+        inline char *write_digits(char *out, std::uint64_t value, const int width) {
+            char tmp[20];
+            int  len = 0;
+            do {
+                tmp[len++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            for (; len < width; len++)
+                tmp[len] = '0';
+            while (len > 0)
+                *out++ = tmp[--len];
+            return out;
+        }
+
+        /**
+         * Integer-only equivalent of strftime "%Y-%m-%d %H:%M:%S" in local time.
+         */
+        inline void format_time(const std::int64_t unix_ms, char (&buffer)[20]) {
+            const std::int64_t unix_s = (unix_ms >= 0 ? unix_ms : unix_ms - 999) / 1000;
+            const std::int64_t local  = unix_s + utc_offset(unix_s);
+            const std::int64_t days   = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+            const std::int64_t secs   = local - days * 86400;
+
+            const std::int64_t z   = days + 719468;
+            const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+            const auto         doe = static_cast<unsigned>(z - era * 146097);
+            const unsigned     yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+            const unsigned     doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+            const unsigned     mp  = (5 * doy + 2) / 153;
+            const unsigned     d   = doy - (153 * mp + 2) / 5 + 1;
+            const unsigned     m   = mp < 10 ? mp + 3 : mp - 9;
+            const std::int64_t y   = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+
+            char *out = buffer;
+            out       = write_digits(out, static_cast<std::uint64_t>(std::clamp<std::int64_t>(y, 0, 9999)), 4);
+            *out++    = '-';
+            out       = write_digits(out, m, 2);
+            *out++    = '-';
+            out       = write_digits(out, d, 2);
+            *out++    = ' ';
+            out       = write_digits(out, static_cast<std::uint64_t>(secs / 3600), 2);
+            *out++    = ':';
+            out       = write_digits(out, static_cast<std::uint64_t>(secs / 60 % 60), 2);
+            *out++    = ':';
+            out       = write_digits(out, static_cast<std::uint64_t>(secs % 60), 2);
+            *out      = '\0';
+        }
+
+        /**
+         * @param human_readable use binary units (KiB, MiB, ...) with one decimal digit instead of raw bytes
+         */
+        inline void format_size(const std::uint64_t size, const bool human_readable, char (&buffer)[24]) {
+            static constexpr const char *units[] = { " B", " KiB", " MiB", " GiB", " TiB", " PiB", " EiB" };
+
+            if (!human_readable || size < 1024) {
+                char *out = write_digits(buffer, size, 1);
+                if (human_readable)
+                    for (const char *u = units[0]; *u != '\0'; u++)
+                        *out++ = *u;
+                *out = '\0';
+                return;
+            }
+
+            int           unit  = 0;
+            std::uint64_t whole = size;
+            while (whole >= 1024 * 1024 && unit < 5) {
+                whole >>= 10;
+                unit++;
+            }
+
+            // whole is in [1024, 1024^2) here, so tenths fit without overflow
+            std::uint64_t tenths = (whole * 10 + 512) / 1024;
+            if (tenths >= 10240 && unit < 5) {
+                tenths = 10;
+                unit++;
+            }
+
+            char *out = write_digits(buffer, tenths / 10, 1);
+            *out++    = '.';
+            *out++    = static_cast<char>('0' + tenths % 10);
+            for (const char *u = units[unit + 1]; *u != '\0'; u++)
+                *out++ = *u;
+            *out = '\0';
+        }
+
+        inline std::size_t get_unix_timestamp_ms(const fs::file_time_type &ftime) {
+            static const auto delta = std::chrono::system_clock::now().time_since_epoch() -
+                                      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                              fs::file_time_type::clock::now().time_since_epoch());
+            const auto since_epoch = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                             ftime.time_since_epoch()) + delta;
+            return static_cast<std::size_t>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count());
+        }
+
+#ifdef SIMPFP_STATS
+        inline thread_local std::uint64_t stat_calls = 0; // issued by enumeration on this thread
+
+        inline std::uint64_t elapsed_ns(const std::chrono::steady_clock::time_point since) {
+            const auto elapsed = std::chrono::steady_clock::now() - since;
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        /**
+         * Stores time elapsed during its lifetime into <b>target</b>.
+         */
+        struct StatTimer {
+            explicit StatTimer(std::uint64_t &target) : target(target) {}
+
+            ~StatTimer() {
+                target = elapsed_ns(start);
+            }
+
+            std::uint64_t                        &target;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        };
+#endif
+
+        /**
+         * Single directory entry as reported by enumerate(), name is only valid inside of callback.
+         */
+        struct DirEntry {
+            const char   *name  = nullptr;
+            std::uint64_t size  = 0;
+            std::int64_t  mtime = 0; // unix epoch, milliseconds
+            fs::perms     perms = fs::perms::none;
+            std::uint64_t dev   = 0; // zero if not known on current platform
+            std::uint64_t ino   = 0;
+            std::uint32_t uid   = 0;
+            std::uint32_t gid   = 0;
+            bool          owner = false; // uid and gid are known
+            bool          dir   = false;
+            bool          link  = false; // reached through a symbolic link
+        };
+
+        /**
+         * Identity of a file or directory, platforms without inodes fall back to hash of canonical path.
+         */
+        struct FileId {
+            std::uint64_t dev = 0;
+            std::uint64_t ino = 0;
+
+            static FileId of(const fs::path &path, const std::uint64_t dev, const std::uint64_t ino) {
+                if (ino != 0)
+                    return { dev, ino };
+                std::error_code ec;
+                return { 0, std::hash<std::string>{}(fs::canonical(path, ec).native()) };
+            }
+
+            bool operator==(const FileId &other) const {
+                return dev == other.dev && ino == other.ino;
+            }
+        };
+
+        struct FileIdHash {
+            std::size_t operator()(const FileId &id) const {
+                return std::hash<std::uint64_t>{}(id.ino * 0x9E3779B97F4A7C15ull ^ id.dev);
+            }
+        };
+
+        /**
+         * Effective identity of the process, taken once per listing, so that access to every entry is
+         * computed from the stat enumeration already did: owner bits, else group bits, else others.
+         */
+        struct Credentials {
+            std::uint32_t              uid = 0;
+            std::uint32_t              gid = 0;
+            std::vector<std::uint32_t> groups; // supplementary, sorted
+
+            static Credentials current() {
+                Credentials who;
+#if defined(__unix__) || defined(__APPLE__)
+                who.uid = static_cast<std::uint32_t>(::geteuid());
+                who.gid = static_cast<std::uint32_t>(::getegid());
+
+                if (const int count = ::getgroups(0, nullptr); count > 0) {
+                    std::vector<gid_t> list(static_cast<std::size_t>(count));
+                    const int          read = ::getgroups(count, list.data());
+                    for (int i = 0; i < read; i++)
+                        who.groups.push_back(static_cast<std::uint32_t>(list[i]));
+                    std::sort(who.groups.begin(), who.groups.end());
+                }
+#endif
+                return who;
+            }
+
+            bool member_of(const std::uint32_t group) const {
+                return group == gid || std::binary_search(groups.begin(), groups.end(), group);
+            }
+
+            /**
+             * @return ENTRY_READ and ENTRY_WRITE flags, directories also need search permission
+             */
+            std::uint8_t access(const DirEntry &entry) const {
+                if (uid == 0)
+                    return ENTRY_READ | ENTRY_WRITE;
+
+                const auto mode = static_cast<std::uint32_t>(entry.perms);
+                const auto bits = entry.uid == uid ? mode >> 6 : member_of(entry.gid) ? mode >> 3 : mode;
+                const bool exec = !entry.dir || (bits & 1) != 0;
+
+                std::uint8_t flags = 0;
+                if ((bits & 4) != 0 && exec)
+                    flags |= ENTRY_READ;
+                if ((bits & 2) != 0 && exec)
+                    flags |= ENTRY_WRITE;
+                return flags;
+            }
+        };
+
+        /**
+         * Portable enumeration backend, one readdir pass plus status, mtime and size per entry.
+         * @param want called with a file name before it is stat'ed, returning false skips the file
+         * @param emit called for every directory and accepted regular file, returning false stops enumeration
+         * @return false if directory could not be opened
+         */
+        template <typename Want, typename Emit>
+        bool enumerate_std(const fs::path &dir, Want &&want, Emit &&emit) {
+            std::error_code        ec;
+            fs::directory_iterator it(dir, ec);
+            if (ec)
+                return false;
+
+            for (; it != fs::directory_iterator(); it.increment(ec)) {
+                if (ec)
+                    break;
+
+                const auto &status = it->status(ec);
+                SIMPFP_STAT(stat_calls++;)
+                if (ec)
+                    continue;
+
+                const bool is_dir = fs::is_directory(status);
+                if (!is_dir && !fs::is_regular_file(status))
+                    continue;
+
+                const auto name = it->path().filename();
+                if (!is_dir && !want(name.c_str()))
+                    continue;
+
+                DirEntry entry;
+                entry.name  = name.c_str();
+                entry.perms = status.permissions();
+                entry.dir   = is_dir;
+                entry.link  = it->is_symlink(ec);
+
+                if (!is_dir) {
+                    entry.mtime = static_cast<std::int64_t>(get_unix_timestamp_ms(it->last_write_time(ec)));
+                    entry.size  = it->file_size(ec);
+                    SIMPFP_STAT(stat_calls += 2;)
+                }
+
+                if (!emit(entry))
+                    break;
+            }
+
+            return true;
+        }
+
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+        /**
+         * Linux enumeration backend: raw getdents64 over a directory fd and at most one fstatat per entry.
+         * Entries whose d_type already tells they are neither file nor directory are never stat'ed,
+         * neither are regular files rejected by <b>want</b>.
+         */
+        template <typename Want, typename Emit>
+        bool enumerate_linux(const fs::path &dir, Want &&want, Emit &&emit) {
+            struct linux_dirent64 {
+                std::uint64_t  d_ino;
+                std::int64_t   d_off;
+                unsigned short d_reclen;
+                unsigned char  d_type;
+                char           d_name[1];
+            };
+
+            const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+                return false;
+
+            constexpr std::size_t buffer_size = 64 * 1024;
+            const auto            buffer      = std::make_unique<char[]>(buffer_size);
+
+            for (bool next = true; next;) {
+                const long read = ::syscall(SYS_getdents64, fd, buffer.get(), buffer_size);
+                if (read <= 0)
+                    break;
+
+                for (long pos = 0; pos < read && next;) {
+                    const auto  ent  = reinterpret_cast<const linux_dirent64 *>(buffer.get() + pos);
+                    const char *name = ent->d_name;
+                    pos += ent->d_reclen;
+
+                    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                        continue;
+
+                    const auto type = ent->d_type;
+                    if (type != DT_DIR && type != DT_REG && type != DT_LNK && type != DT_UNKNOWN)
+                        continue;
+
+                    if (type == DT_REG && !want(name))
+                        continue;
+
+                    struct stat st {};
+                    SIMPFP_STAT(stat_calls++;)
+                    if (::fstatat(fd, name, &st, 0) != 0)
+                        continue;
+
+                    const bool is_dir = S_ISDIR(st.st_mode);
+                    if (!is_dir && !S_ISREG(st.st_mode))
+                        continue;
+
+                    if (!is_dir && type != DT_REG && !want(name))
+                        continue;
+
+                    DirEntry entry;
+                    entry.name  = name;
+                    entry.perms = static_cast<fs::perms>(st.st_mode & 07777);
+                    entry.dev   = static_cast<std::uint64_t>(st.st_dev);
+                    entry.ino   = static_cast<std::uint64_t>(st.st_ino);
+                    entry.uid   = static_cast<std::uint32_t>(st.st_uid);
+                    entry.gid   = static_cast<std::uint32_t>(st.st_gid);
+                    entry.owner = true;
+                    entry.dir   = is_dir;
+                    entry.link  = type == DT_LNK;
+
+                    if (!is_dir) {
+                        entry.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000 +
+                                      st.st_mtim.tv_nsec / 1000000;
+                        entry.size  = static_cast<std::uint64_t>(st.st_size);
+                    }
+
+                    next = emit(entry);
+                }
+            }
+
+            ::close(fd);
+            return true;
+        }
+#endif
+
+        /**
+         * Enumerates directory using the cheapest backend available on current platform.
+         * @see enumerate_std
+         */
+        template <typename Want, typename Emit>
+        bool enumerate(const fs::path &dir, Want &&want, Emit &&emit) {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+            return enumerate_linux(dir, std::forward<Want>(want), std::forward<Emit>(emit));
+#else
+            return enumerate_std(dir, std::forward<Want>(want), std::forward<Emit>(emit));
+#endif
+        }
+
+        /**
+         * Looks up a single entry by name, following the same rules as enumerate().
+         * @return false if entry does not exist or is neither a directory nor a regular file
+         */
+        inline bool stat_entry(const fs::path &dir, const char *name, DirEntry &entry) {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+            struct stat st {};
+            if (::stat((dir / name).c_str(), &st) != 0)
+                return false;
+
+            entry.dir = S_ISDIR(st.st_mode);
+            if (!entry.dir && !S_ISREG(st.st_mode))
+                return false;
+
+            entry.name  = name;
+            entry.perms = static_cast<fs::perms>(st.st_mode & 07777);
+            entry.dev   = static_cast<std::uint64_t>(st.st_dev);
+            entry.ino   = static_cast<std::uint64_t>(st.st_ino);
+            entry.uid   = static_cast<std::uint32_t>(st.st_uid);
+            entry.gid   = static_cast<std::uint32_t>(st.st_gid);
+            entry.owner = true;
+            entry.mtime = 0;
+            entry.size  = 0;
+            if (!entry.dir) {
+                entry.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+                entry.size  = static_cast<std::uint64_t>(st.st_size);
+            }
+#else
+            std::error_code ec;
+            const auto      path   = dir / name;
+            const auto      status = fs::status(path, ec);
+            if (ec)
+                return false;
+
+            entry.dir = fs::is_directory(status);
+            if (!entry.dir && !fs::is_regular_file(status))
+                return false;
+
+            entry.name  = name;
+            entry.perms = status.permissions();
+            entry.mtime = 0;
+            entry.size  = 0;
+            if (!entry.dir) {
+                entry.mtime = static_cast<std::int64_t>(get_unix_timestamp_ms(fs::last_write_time(path, ec)));
+                entry.size  = fs::file_size(path, ec);
+            }
+#endif
+            return true;
+        }
+
+        /**
+         * Identity and modification times of a directory, changes whenever an entry is added, removed
+         * or renamed, or directory permissions change.
+         */
+        struct DirStamp {
+            std::uint64_t dev   = 0;
+            std::uint64_t ino   = 0;
+            std::int64_t  mtime = 0; // nanoseconds
+            std::int64_t  ctime = 0; // nanoseconds
+            bool          valid = false;
+
+            bool operator==(const DirStamp &other) const {
+                return valid && other.valid && dev == other.dev && ino == other.ino && mtime == other.mtime &&
+                       ctime == other.ctime;
+            }
+        };
+
+        inline DirStamp dir_stamp(const fs::path &dir) {
+            DirStamp stamp;
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+            struct stat st {};
+            if (::stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+                return stamp;
+            stamp.dev   = static_cast<std::uint64_t>(st.st_dev);
+            stamp.ino   = static_cast<std::uint64_t>(st.st_ino);
+            stamp.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            stamp.ctime = static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#else
+            std::error_code ec;
+            const auto      time = fs::last_write_time(dir, ec);
+            if (ec)
+                return stamp;
+            stamp.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+#endif
+            stamp.valid = true;
+            return stamp;
+        }
+
+        /**
+         * Monotonic allocator owning every string of a single listing, all of it released at once.
+         * Repeating strings (extensions, timestamps) are interned and stored only once.
+         */
+        struct Arena {
+            static constexpr std::size_t min_chunk = 16 * 1024;
+            static constexpr std::size_t max_chunk = 1024 * 1024;
+            static constexpr std::size_t header    = alignof(std::max_align_t);
+
+            Arena() = default;
+
+            Arena(const Arena &)            = delete;
+            Arena &operator=(const Arena &) = delete;
+
+            ~Arena() {
+                while (head != nullptr) {
+                    const auto next = *reinterpret_cast<char **>(head);
+                    std::free(head);
+                    head = next;
+                }
+            }
+
+            void *allocate(const std::size_t size, const std::size_t align = 1) {
+                std::size_t offset = (used + align - 1) & ~(align - 1);
+                if (head == nullptr || offset + size > capacity) {
+                    next_chunk(size + align);
+                    offset = (used + align - 1) & ~(align - 1);
+                }
+                used = offset + size;
+                return head + offset;
+            }
+
+            const char *copy(const char *str, const std::size_t len) {
+                const auto dst = static_cast<char *>(allocate(len + 1));
+                std::memcpy(dst, str, len);
+                dst[len] = '\0';
+                return dst;
+            }
+
+            /**
+             * @param tail receives pointer to the copy of <b>str</b> inside of the result
+             * @return null-terminated <b>prefix</b> + <b>str</b>, with a path separator in between if needed
+             */
+            const char *join(const std::string &prefix, const char *str, const char **tail) {
+                constexpr auto separator = static_cast<char>(fs::path::preferred_separator);
+
+                const bool        sep     = !prefix.empty() && prefix.back() != separator;
+                const std::size_t str_len = std::strlen(str);
+                const std::size_t pre_len = prefix.size() + (sep ? 1 : 0);
+
+                const auto dst = static_cast<char *>(allocate(pre_len + str_len + 1));
+                std::memcpy(dst, prefix.data(), prefix.size());
+                if (sep)
+                    dst[prefix.size()] = separator;
+                std::memcpy(dst + pre_len, str, str_len + 1);
+
+                *tail = dst + pre_len;
+                return dst;
+            }
+
+            const char *intern(const char *str) {
+                const std::string_view key(str);
+                if (const auto it = pool.find(key); it != pool.end())
+                    return it->second;
+                const auto dst = copy(str, key.size());
+                pool.emplace(std::string_view(dst, key.size()), dst);
+                return dst;
+            }
+
+            std::size_t bytes() const {
+                return total;
+            }
+
+        private:
+            char       *head     = nullptr;
+            std::size_t used     = 0;
+            std::size_t capacity = 0;
+            std::size_t chunk    = min_chunk;
+            std::size_t total    = 0;
+
+            std::unordered_map<std::string_view, const char *> pool;
+
+            void next_chunk(const std::size_t min_size) {
+                const std::size_t size = std::max(chunk, min_size + header);
+                const auto        next = static_cast<char *>(std::malloc(size));
+                if (next == nullptr)
+                    throw std::bad_alloc();
+                *reinterpret_cast<char **>(next) = head;
+
+                head     = next;
+                used     = header;
+                capacity = size;
+                total += size;
+                chunk = std::min(chunk * 2, max_chunk);
+            }
+        };
+
+        /**
+         * Ranks <b>name</b> against a fuzzy <b>query</b>, both expected to be lowercased.
+         * Substring matches always rank above scattered ones, prefix and word-start matches rank highest.
+         * @return rank in 1..255, or 0 if query is not a subsequence of the name
+         */
+        inline int fuzzy_score(const std::string_view name, const std::string_view query) {
+            if (query.empty())
+                return 1;
+
+            const auto boundary = [&name](const std::size_t pos) {
+                if (pos == 0)
+                    return true;
+                const char c = name[pos - 1];
+                return c == '.' || c == '_' || c == '-' || c == ' ';
+            };
+
+            // greedy subsequence pass first, it rejects most of the names in a single scan
+            int         score = 0;
+            std::size_t at    = 0;
+            std::size_t prev  = std::string_view::npos;
+            for (const char c : query) {
+                const auto found = static_cast<const char *>(std::memchr(name.data() + at, c, name.size() - at));
+                if (found == nullptr)
+                    return 0;
+
+                const auto pos = static_cast<std::size_t>(found - name.data());
+                score += 4;
+                if (prev != std::string_view::npos && pos == prev + 1)
+                    score += 6;
+                else if (boundary(pos))
+                    score += 4;
+                else if (prev != std::string_view::npos)
+                    score -= static_cast<int>(std::min<std::size_t>(pos - prev - 1, 3));
+
+                prev = pos;
+                at   = pos + 1;
+            }
+
+            const int extra = static_cast<int>(std::min<std::size_t>(name.size() - query.size(), 31));
+
+            const auto pos = query.size() == 1 ? prev : name.find(query);
+            if (pos != std::string_view::npos)
+                return 160 + (pos == 0 ? 64 : boundary(pos) ? 32 : 0) - extra;
+
+            return std::clamp(score - extra / 4, 1, 159);
+        }
+
+        /**
+         * Column store of a single directory listing.
+         * Entry id is an index shared by all columns, names are kept null-terminated in a single blob.
+         */
+        struct Listing {
+            std::vector<std::uint64_t> size;
+            std::vector<std::int64_t>  mtime;    // unix epoch, milliseconds
+            std::vector<std::uint32_t> name;     // offset in names
+            std::vector<std::uint32_t> type;     // index in types
+            std::vector<std::uint8_t>  flags;    // ENTRY_*
+            std::vector<std::uint64_t> name_key; // first 8 bytes of name, big-endian
+            std::vector<std::uint32_t> coll;     // offset in colls
+            std::vector<std::uint64_t> coll_key; // first 8 bytes of collation key, big-endian
+            std::vector<std::uint64_t> chars;    // set of characters in name, see signature()
+            std::vector<std::uint64_t> selection;
+
+            std::vector<char>         names;
+            std::vector<char>         lower; // names lowercased, same offsets as in names
+            std::vector<char>         colls;
+            std::vector<const char *> types;
+
+            std::uint32_t count() const {
+                return static_cast<std::uint32_t>(flags.size());
+            }
+
+            const char *name_of(const std::uint32_t id) const {
+                return names.data() + name[id];
+            }
+
+            std::size_t length_of(const std::uint32_t id) const {
+                const std::size_t end = id + 1 < count() ? name[id + 1] : names.size();
+                return end - name[id] - 1;
+            }
+
+            const char *lower_of(const std::uint32_t id) const {
+                return lower.data() + name[id];
+            }
+
+            const char *type_of(const std::uint32_t id) const {
+                return types[type[id]];
+            }
+
+            std::string_view collation_of(const std::uint32_t id) const {
+                const std::size_t end = id + 1 < count() ? coll[id + 1] : colls.size();
+                return { colls.data() + coll[id], end - coll[id] };
+            }
+
+            bool is(const std::uint32_t id, const std::uint8_t flag) const {
+                return (flags[id] & flag) != 0;
+            }
+
+            bool selected(const std::uint32_t id) const {
+                return (selection[id >> 6] >> (id & 63)) & 1;
+            }
+
+            void select(const std::uint32_t id, const bool value) {
+                if (value)
+                    selection[id >> 6] |= (std::uint64_t{ 1 } << (id & 63));
+                else
+                    selection[id >> 6] &= ~(std::uint64_t{ 1 } << (id & 63));
+            }
+
+            void clear_selection() {
+                std::fill(selection.begin(), selection.end(), 0);
+            }
+
+            std::uint32_t add(const char *file_name, const std::uint8_t entry_flags, const std::uint32_t type_id,
+                              const std::uint64_t file_size, const std::int64_t file_mtime) {
+                const std::size_t len = std::strlen(file_name);
+                name_key.push_back(pack_prefix(file_name, len));
+                name.push_back(static_cast<std::uint32_t>(names.size()));
+                names.insert(names.end(), file_name, file_name + len + 1);
+
+                std::uint64_t set = 0;
+                for (std::size_t i = 0; i <= len; i++) {
+                    const char c = to_lower(file_name[i]);
+                    lower.push_back(c);
+                    set |= signature(c);
+                }
+                chars.push_back(set);
+
+                const std::size_t coll_at = colls.size();
+                coll.push_back(static_cast<std::uint32_t>(coll_at));
+                collate(file_name, len, colls);
+                coll_key.push_back(pack_prefix(colls.data() + coll_at, colls.size() - coll_at));
+
+                flags.push_back(entry_flags);
+                type.push_back(type_id);
+                size.push_back(file_size);
+                mtime.push_back(file_mtime);
+                selection.resize((flags.size() + 63) / 64, 0);
+                return count() - 1;
+            }
+
+            /**
+             * Moves all entries of <b>other</b> to the end of this listing, type ids are expected to be shared.
+             */
+            void append(const Listing &other) {
+                const auto base = static_cast<std::uint32_t>(names.size());
+                names.insert(names.end(), other.names.begin(), other.names.end());
+                lower.insert(lower.end(), other.lower.begin(), other.lower.end());
+                name.reserve(name.size() + other.name.size());
+                for (const auto offset : other.name)
+                    name.push_back(base + offset);
+                const auto coll_base = static_cast<std::uint32_t>(colls.size());
+                colls.insert(colls.end(), other.colls.begin(), other.colls.end());
+                coll.reserve(coll.size() + other.coll.size());
+                for (const auto offset : other.coll)
+                    coll.push_back(coll_base + offset);
+                coll_key.insert(coll_key.end(), other.coll_key.begin(), other.coll_key.end());
+                size.insert(size.end(), other.size.begin(), other.size.end());
+                mtime.insert(mtime.end(), other.mtime.begin(), other.mtime.end());
+                type.insert(type.end(), other.type.begin(), other.type.end());
+                flags.insert(flags.end(), other.flags.begin(), other.flags.end());
+                name_key.insert(name_key.end(), other.name_key.begin(), other.name_key.end());
+                chars.insert(chars.end(), other.chars.begin(), other.chars.end());
+                selection.resize((flags.size() + 63) / 64, 0);
+            }
+
+            void clear() {
+                size.clear();
+                mtime.clear();
+                name.clear();
+                type.clear();
+                flags.clear();
+                name_key.clear();
+                coll.clear();
+                coll_key.clear();
+                chars.clear();
+                selection.clear();
+                names.clear();
+                lower.clear();
+                colls.clear();
+            }
+
+            bool empty() const {
+                return flags.empty();
+            }
+
+            /**
+             * @return approximate heap memory held by the listing, in bytes
+             */
+            std::size_t bytes() const {
+                return size.capacity() * sizeof(std::uint64_t) + mtime.capacity() * sizeof(std::int64_t) +
+                       name.capacity() * sizeof(std::uint32_t) + type.capacity() * sizeof(std::uint32_t) +
+                       flags.capacity() + name_key.capacity() * sizeof(std::uint64_t) +
+                       coll.capacity() * sizeof(std::uint32_t) + coll_key.capacity() * sizeof(std::uint64_t) +
+                       chars.capacity() * sizeof(std::uint64_t) + selection.capacity() * sizeof(std::uint64_t) +
+                       names.capacity() + lower.capacity() + colls.capacity() +
+                       types.capacity() * sizeof(const char *);
+            }
+
+            /**
+             * Packs first 8 bytes of a string so that integer order equals strcmp order of the prefix.
+             */
+            static std::uint64_t pack_prefix(const char *str, const std::size_t len) {
+                std::uint64_t key = 0;
+                for (std::size_t i = 0; i < 8; i++)
+                    key = (key << 8) | (i < len ? static_cast<unsigned char>(str[i]) : 0);
+                return key;
+            }
+
+            /**
+             * Appends collation key of a name, so that plain byte comparison of two keys gives
+             * natural, case-folded order: ASCII letters are lowered and every run of digits becomes
+             * '0', count of significant digits + 1 and the digits themselves ("file2" < "File10").
+             */
+            static void collate(const char *str, const std::size_t len, std::vector<char> &out) {
+                for (std::size_t i = 0; i < len;) {
+                    const auto c = static_cast<unsigned char>(str[i]);
+                    if (c < '0' || c > '9') {
+                        out.push_back(static_cast<char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c));
+                        i++;
+                        continue;
+                    }
+
+                    while (i < len && str[i] == '0' && i + 1 < len && str[i + 1] >= '0' && str[i + 1] <= '9')
+                        i++;
+
+                    std::size_t end = i;
+                    while (end < len && str[end] >= '0' && str[end] <= '9')
+                        end++;
+
+                    const std::size_t digits = std::min<std::size_t>(end - i, 254);
+                    out.push_back('0');
+                    out.push_back(static_cast<char>(digits + 1));
+                    out.insert(out.end(), str + i, str + i + digits);
+                    i = end;
+                }
+            }
+
+            static char to_lower(const char c) {
+                return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+            }
+
+            /**
+             * Character as a bit of 64-bit set: letters and digits get a bit each, the rest share remaining ones.
+             * A name can contain query as a subsequence only if its set is a superset of the query's one.
+             */
+            static std::uint64_t signature(const char c) {
+                const auto u = static_cast<unsigned char>(c);
+                if (u == 0)
+                    return 0;
+                if (u >= 'a' && u <= 'z')
+                    return std::uint64_t{ 1 } << (u - 'a');
+                if (u >= '0' && u <= '9')
+                    return std::uint64_t{ 1 } << (26 + u - '0');
+                return std::uint64_t{ 1 } << (36 + u % 28);
+            }
+
+            static int compare_collation(const std::string_view a, const std::string_view b) {
+                // empty keys may have no storage at all, memcmp must not see a null pointer
+                const auto n = std::min(a.size(), b.size());
+                const int  r = n == 0 ? 0 : std::memcmp(a.data(), b.data(), n);
+                if (r != 0)
+                    return r;
+                return (a.size() > b.size()) - (a.size() < b.size());
+            }
+        };
+
+        struct SortSpec {
+            char by    = SORT_NONE;
+            char order = SORT_NONE;
+        };
+
+        /**
+         * Fixed set of background threads consuming a FIFO of tasks.
+         * Every task receives the pool's stop flag, so long-running work can bail out on shutdown.
+         */
+        struct TaskPool {
+            using Task = std::function<void(const std::atomic<bool> &stop)>;
+
+            explicit TaskPool(const int threads) {
+                for (int i = 0; i < threads; i++)
+                    workers.emplace_back([this] { run(); });
+            }
+
+            ~TaskPool() {
+                {
+                    std::lock_guard lock(mutex);
+                    stop = true;
+                    tasks.clear();
+                }
+                cond.notify_all();
+                for (auto &worker : workers)
+                    worker.join();
+            }
+
+            TaskPool(const TaskPool &)            = delete;
+            TaskPool &operator=(const TaskPool &) = delete;
+
+            void submit(Task task) {
+                {
+                    std::lock_guard lock(mutex);
+                    tasks.push_back(std::move(task));
+                }
+                cond.notify_one();
+            }
+
+        private:
+            std::vector<std::thread> workers;
+            std::deque<Task>         tasks;
+            std::mutex               mutex;
+            std::condition_variable  cond;
+            std::atomic<bool>        stop = false;
+
+            void run() {
+                for (;;) {
+                    Task task;
+                    {
+                        std::unique_lock lock(mutex);
+                        cond.wait(lock, [this] { return stop || !tasks.empty(); });
+                        if (stop)
+                            return;
+                        task = std::move(tasks.front());
+                        tasks.pop_front();
+                    }
+                    task(stop);
+                }
+            }
+        };
+
+        inline TaskPool &loader_pool() {
+            static TaskPool pool(2);
+            return pool;
+        }
+
+        /**
+         * State shared between a directory scan running on the loader pool and the UI thread.
+         * Worker appends finished entries to the pending listing, UI drains it once per frame.
+         */
+        struct LoadJob {
+            static constexpr std::size_t first_batch = 64;
+            static constexpr std::size_t max_batch   = 8192;
+
+            std::atomic<bool> cancel = false;
+            std::atomic<bool> done   = false;
+
+            std::shared_ptr<Arena> arena;
+            DirStamp               stamp; // taken before enumeration started
+
+            std::mutex mutex;
+            Listing    pending;
+
+#ifdef SIMPFP_STATS
+            std::atomic<std::uint64_t> scan_ns    = 0;
+            std::atomic<std::uint64_t> scanned    = 0;
+            std::atomic<std::uint64_t> stat_calls = 0;
+#endif
+        };
+
+        /**
+         * Most recently used listings, so that going back to a directory or re-opening the dialog
+         * needs no enumeration. Entries are validated by directory identity and mtime on lookup.
+         * Accessed from the thread driving models and dialogs only.
+         */
+        struct ListingCache {
+            struct Entry {
+                std::string            path;
+                DirStamp               stamp;
+                Listing                listing;
+                std::shared_ptr<Arena> arena; // owns extension strings of listing
+                std::size_t            bytes = 0;
+                bool                   read  = false;
+                bool                   write = false;
+            };
+
+            std::size_t max_entries = 16;
+            std::size_t max_bytes   = 64 * 1024 * 1024;
+
+            std::size_t hits   = 0;
+            std::size_t misses = 0;
+            std::size_t bytes  = 0;
+
+            /**
+             * @return cached entry matching given stamp, or nullptr; stale entries are dropped
+             */
+            const Entry *find(const std::string &path, const DirStamp &stamp) {
+                const auto it = index.find(path);
+                if (it == index.end()) {
+                    misses++;
+                    return nullptr;
+                }
+
+                if (!(it->second->stamp == stamp)) {
+                    erase(it->second);
+                    misses++;
+                    return nullptr;
+                }
+
+                hits++;
+                entries.splice(entries.begin(), entries, it->second);
+                return &entries.front();
+            }
+
+            void store(const std::string &path, const DirStamp &stamp, const Listing &listing,
+                       const std::shared_ptr<Arena> &arena, const bool read, const bool write) {
+                if (!stamp.valid || max_entries == 0)
+                    return;
+
+                forget(path);
+
+                // checked before copying, listings too big for the cache are not worth a copy on the UI thread
+                const auto size = listing.bytes() + arena->bytes() + path.size();
+                if (size > max_bytes)
+                    return;
+
+                Entry entry{ path, stamp, listing, arena, size, read, write };
+                entry.listing.clear_selection();
+
+                entries.push_front(std::move(entry));
+                index.emplace(entries.front().path, entries.begin());
+                bytes += entries.front().bytes;
+                trim();
+            }
+
+            void forget(const std::string &path) {
+                if (const auto it = index.find(path); it != index.end())
+                    erase(it->second);
+            }
+
+            /**
+             * @return true if there is an entry for given path, stale or not; does not count as lookup
+             */
+            bool contains(const std::string &path) const {
+                return index.find(path) != index.end();
+            }
+
+            void resize(const std::size_t entries_num, const std::size_t bytes_num) {
+                max_entries = entries_num;
+                max_bytes   = bytes_num;
+                trim();
+            }
+
+            std::size_t size() const {
+                return entries.size();
+            }
+
+        private:
+            std::list<Entry>                                                entries; // most recent first
+            std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+
+            void erase(const std::list<Entry>::iterator it) {
+                bytes -= it->bytes;
+                index.erase(it->path);
+                entries.erase(it);
+            }
+
+            void trim() {
+                while (!entries.empty() && (entries.size() > max_entries || bytes > max_bytes))
+                    erase(std::prev(entries.end()));
+            }
+        };
+
+        inline ListingCache &listing_cache() {
+            static ListingCache cache;
+            return cache;
+        }
+
+        /**
+         * Listings enumerated ahead of time, for directories the user is likely to enter next
+         * (hovered or focused ones, parent of current one). Few of them are kept, in request order,
+         * and each is abandoned once it grows over the byte budget, so huge directories are only
+         * ever loaded on demand. Accessed from the thread driving models and dialogs only.
+         */
+        struct Prefetcher {
+            static constexpr std::size_t max_jobs  = 4;
+            static constexpr std::size_t max_bytes = 8 * 1024 * 1024; // of single listing
+            static constexpr std::size_t max_skips = 64;
+
+            ~Prefetcher() {
+                clear();
+            }
+
+            /**
+             * @return new job to be scanned for given directory, or nullptr if it is already known
+             */
+            std::shared_ptr<LoadJob> start(const std::string &path) {
+                if (find(path) != jobs.end() || skipped.count(path) != 0)
+                    return nullptr;
+
+                if (jobs.size() >= max_jobs) {
+                    jobs.front().job->cancel = true;
+                    jobs.pop_front();
+                }
+
+                const auto job = std::make_shared<LoadJob>();
+                job->arena     = std::make_shared<Arena>();
+                jobs.push_back({ path, job });
+                return job;
+            }
+
+            /**
+             * Hands over finished listing of given directory, if the directory did not change since.
+             * Unfinished one is abandoned: it runs at idle priority behind other prefetches, so a directory
+             * actually entered is scanned again on the loader pool instead.
+             * @return finished job of given directory, or nullptr if there is none
+             */
+            std::shared_ptr<LoadJob> adopt(const std::string &path, const DirStamp &stamp) {
+                const auto it = find(path);
+                if (it == jobs.end())
+                    return nullptr;
+
+                auto job = std::move(it->job);
+                jobs.erase(it);
+                if (!job->done) {
+                    job->cancel = true;
+                    return nullptr;
+                }
+                if (!(job->stamp == stamp))
+                    return nullptr;
+                return job;
+            }
+
+            void forget(const std::string &path) {
+                if (const auto it = find(path); it != jobs.end()) {
+                    it->job->cancel = true;
+                    jobs.erase(it);
+                }
+            }
+
+            /**
+             * Abandons listings which grew over the budget, should be called once per frame.
+             */
+            void trim() {
+                for (auto it = jobs.begin(); it != jobs.end();) {
+                    std::size_t bytes = 0;
+                    {
+                        std::lock_guard lock(it->job->mutex);
+                        bytes = it->job->pending.bytes();
+                    }
+
+                    if (bytes <= max_bytes) {
+                        ++it;
+                        continue;
+                    }
+
+                    if (skipped.size() >= max_skips)
+                        skipped.clear();
+                    skipped.insert(it->path);
+                    it->job->cancel = true;
+                    it = jobs.erase(it);
+                }
+            }
+
+            void clear() {
+                for (const auto &entry : jobs)
+                    entry.job->cancel = true;
+                jobs.clear();
+            }
+
+        private:
+            struct Entry {
+                std::string              path;
+                std::shared_ptr<LoadJob> job;
+            };
+
+            std::deque<Entry>               jobs;    // oldest first
+            std::unordered_set<std::string> skipped; // too big to be prefetched
+
+            std::deque<Entry>::iterator find(const std::string &path) {
+                return std::find_if(jobs.begin(), jobs.end(), [&](const Entry &entry) { return entry.path == path; });
+            }
+        };
+
+        inline Prefetcher &prefetcher() {
+            static Prefetcher prefetcher;
+            return prefetcher;
+        }
+
+        /**
+         * Prefetched listings are enumerated on their own worker, so they never delay requested ones.
+         */
+        inline TaskPool &prefetch_pool() {
+            static TaskPool pool(1);
+            return pool;
+        }
+
+        /**
+         * Head of a file rendered for display: text as is, anything else as hex dump.
+         * Immutable once published, shared between preview cache and views.
+         */
+        struct Preview {
+            static constexpr std::size_t text_bytes = 16 * 1024; // read at most this much of text files
+            static constexpr std::size_t text_lines = 200;
+            static constexpr std::size_t hex_bytes  = 1024;      // dumped bytes of binary files
+
+            std::string   path;
+            std::uint64_t size      = 0; // as listed, validates cached preview
+            std::int64_t  mtime     = 0;
+            bool          binary    = false;
+            bool          failed    = false; // could not be opened or read
+            bool          truncated = false; // text holds only the head of the file
+            std::string   text;
+
+            std::size_t bytes() const {
+                return sizeof(Preview) + path.capacity() + text.capacity();
+            }
+        };
+
+        /**
+         * @return true if head looks like text: no NUL bytes and only few control characters (UTF-8 passes)
+         */
+        inline bool is_text(const unsigned char *data, const std::size_t length) {
+            std::size_t control = 0;
+            for (std::size_t i = 0; i < length; i++) {
+                const auto c = data[i];
+                if (c == 0)
+                    return false;
+                if (c < 32 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != 27)
+                    control++;
+            }
+            return control * 32 <= length;
+        }
+
+        inline void render_text(Preview &preview, const unsigned char *data, const std::size_t length) {
+            std::size_t lines = 0;
+            std::size_t i     = 0;
+            preview.text.reserve(length);
+            for (; i < length && lines < Preview::text_lines; i++) {
+                const auto c = data[i];
+                if (c == '\n')
+                    lines++;
+                if (c == '\r')
+                    continue;
+                preview.text.push_back(c < 32 && c != '\n' && c != '\t' ? '.' : static_cast<char>(c));
+            }
+            preview.truncated = i < preview.size;
+        }
+
+        inline void render_hex(Preview &preview, const unsigned char *data, const std::size_t length) {
+            static constexpr char digits[] = "0123456789abcdef";
+
+            const std::size_t count = std::min(length, Preview::hex_bytes);
+            preview.text.reserve((count / 16 + 1) * 78);
+            for (std::size_t row = 0; row < count; row += 16) {
+                char  line[80];
+                char *out = line;
+                for (int shift = 28; shift >= 0; shift -= 4)
+                    *out++ = digits[(row >> shift) & 0xF];
+                *out++ = ' ';
+                for (std::size_t k = 0; k < 16; k++) {
+                    *out++ = ' ';
+                    if (row + k < count) {
+                        *out++ = digits[data[row + k] >> 4];
+                        *out++ = digits[data[row + k] & 0xF];
+                    }
+                    else {
+                        *out++ = ' ';
+                        *out++ = ' ';
+                    }
+                }
+                *out++ = ' ';
+                *out++ = ' ';
+                for (std::size_t k = 0; k < 16 && row + k < count; k++) {
+                    const auto c = data[row + k];
+                    *out++       = c >= 32 && c < 127 ? static_cast<char>(c) : '.';
+                }
+                *out++ = '\n';
+                preview.text.append(line, out);
+            }
+            preview.truncated = count < preview.size;
+        }
+
+        /**
+         * Renders head of given file. Only the head is mapped (mmap, read elsewhere), nothing else is touched.
+         */
+        inline void make_preview(Preview &preview, const std::atomic<bool> &cancel) {
+            std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(preview.size, Preview::text_bytes));
+            if (length == 0 || cancel)
+                return;
+
+            const auto render = [&](const unsigned char *data, const std::size_t read) {
+                if (cancel)
+                    return;
+                preview.binary = !is_text(data, read);
+                if (preview.binary)
+                    render_hex(preview, data, read);
+                else
+                    render_text(preview, data, read);
+            };
+
+#if defined(__unix__) || defined(__APPLE__)
+            const int fd = ::open(preview.path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+            if (fd < 0) {
+                preview.failed = true;
+                return;
+            }
+
+            // reading devices or pipes may block or have side effects
+            struct stat st {};
+            if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                preview.failed = true;
+                ::close(fd);
+                return;
+            }
+
+            // file may have shrunk since it was listed, mapping past its end raises SIGBUS
+            length = std::min<std::size_t>(length, static_cast<std::size_t>(st.st_size));
+            if (length == 0) {
+                ::close(fd);
+                return;
+            }
+
+            if (void *map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0); map != MAP_FAILED) {
+                render(static_cast<const unsigned char *>(map), length);
+                ::munmap(map, length);
+            }
+            else {
+                // file systems without mmap support
+                std::vector<unsigned char> head(length);
+                const auto                 read = ::pread(fd, head.data(), length, 0);
+                if (read < 0)
+                    preview.failed = true;
+                else
+                    render(head.data(), static_cast<std::size_t>(read));
+            }
+            ::close(fd);
+#else
+            std::FILE *file = std::fopen(preview.path.c_str(), "rb");
+            if (file == nullptr) {
+                preview.failed = true;
+                return;
+            }
+            std::vector<unsigned char> head(length);
+            render(head.data(), std::fread(head.data(), 1, length, file));
+            std::fclose(file);
+#endif
+        }
+
+        /**
+         * Previews are rendered on their own worker, so they never queue up behind directory scans.
+         */
+        inline TaskPool &preview_pool() {
+            static TaskPool pool(1);
+            return pool;
+        }
+
+        struct PreviewJob {
+            std::atomic<bool> cancel = false;
+            std::atomic<bool> done   = false;
+
+            std::shared_ptr<Preview> preview; // owned by worker until done
+        };
+
+        /**
+         * Most recently viewed previews within a byte budget, validated by listed size and mtime.
+         * Accessed from the thread driving models and dialogs only.
+         */
+        struct PreviewCache {
+            std::size_t max_bytes = 8 * 1024 * 1024;
+            std::size_t bytes     = 0;
+
+            std::shared_ptr<const Preview> find(const std::string &path, const std::uint64_t size,
+                                                const std::int64_t mtime) {
+                const auto it = index.find(path);
+                if (it == index.end())
+                    return nullptr;
+
+                const auto &preview = *it->second;
+                if (preview->size != size || preview->mtime != mtime) {
+                    erase(it->second);
+                    return nullptr;
+                }
+
+                entries.splice(entries.begin(), entries, it->second);
+                return entries.front();
+            }
+
+            void store(const std::shared_ptr<const Preview> &preview) {
+                if (const auto it = index.find(preview->path); it != index.end())
+                    erase(it->second);
+                if (preview->failed || preview->bytes() > max_bytes)
+                    return;
+
+                entries.push_front(preview);
+                index.emplace(preview->path, entries.begin());
+                bytes += preview->bytes();
+                trim();
+            }
+
+            void resize(const std::size_t bytes_num) {
+                max_bytes = bytes_num;
+                trim();
+            }
+
+        private:
+            using Entries = std::list<std::shared_ptr<const Preview>>;
+
+            Entries                                                 entries; // most recent first
+            std::unordered_map<std::string_view, Entries::iterator> index;
+
+            void erase(const Entries::iterator it) {
+                bytes -= (*it)->bytes();
+                index.erase((*it)->path);
+                entries.erase(it);
+            }
+
+            void trim() {
+                while (!entries.empty() && bytes > max_bytes)
+                    erase(std::prev(entries.end()));
+            }
+        };
+
+        inline PreviewCache &preview_cache() {
+            static PreviewCache cache;
+            return cache;
+        }
+
+        /**
+         * Preview of a single file at a time: moving to another file cancels rendering of the previous one,
+         * previews seen recently show up immediately.
+         */
+        struct Previewer {
+            std::shared_ptr<const Preview> shown; // nullptr while rendering
+            std::shared_ptr<PreviewJob>    job;
+            std::string                    target;
+
+            ~Previewer() {
+                clear();
+            }
+
+            void request(const std::string &path, const std::uint64_t size, const std::int64_t mtime) {
+                if (path == target)
+                    return;
+
+                clear();
+                target = path;
+
+                if ((shown = preview_cache().find(path, size, mtime)) != nullptr)
+                    return;
+
+                auto preview   = std::make_shared<Preview>();
+                preview->path  = path;
+                preview->size  = size;
+                preview->mtime = mtime;
+
+                job          = std::make_shared<PreviewJob>();
+                job->preview = std::move(preview);
+                preview_pool().submit([job = job](const std::atomic<bool> &stop) {
+                    if (job->cancel || stop)
+                        return;
+                    make_preview(*job->preview, job->cancel);
+                    job->done = true;
+                });
+            }
+
+            /**
+             * @return true if preview of current target has just become available
+             */
+            bool poll() {
+                if (job == nullptr || !job->done)
+                    return false;
+
+                shown = std::move(job->preview);
+                job   = nullptr;
+                preview_cache().store(shown);
+                return true;
+            }
+
+            void clear() {
+                if (job != nullptr)
+                    job->cancel = true;
+                job   = nullptr;
+                shown = nullptr;
+                target.clear();
+            }
+        };
+
+        /**
+         * Sums up files of a whole subtree. Each directory is entered once, links to directories are skipped.
+         * @return false if cancelled
+         */
+        template <typename Stopped>
+        bool dir_usage(const fs::path &root, DirUsage &usage, Stopped &&stopped) {
+            std::vector<fs::path>                  stack{ root };
+            std::unordered_set<FileId, FileIdHash> seen;
+
+            const auto want = [](const char *) { return true; };
+
+            while (!stack.empty() && !stopped()) {
+                const auto dir = std::move(stack.back());
+                stack.pop_back();
+
+                enumerate(dir, want, [&](const DirEntry &entry) {
+                    if (stopped())
+                        return false;
+                    if (!entry.dir) {
+                        usage.size += entry.size;
+                        usage.files++;
+                        usage.mtime = std::max(usage.mtime, entry.mtime);
+                    }
+                    else if (!entry.link) {
+                        auto path = dir / entry.name;
+                        if (seen.insert(FileId::of(path, entry.dev, entry.ino)).second)
+                            stack.push_back(std::move(path));
+                    }
+                    return true;
+                });
+            }
+            return !stopped();
+        }
+
+        /**
+         * Recursive totals by directory identity. Validated by directory stamp, which only reflects
+         * direct children, so entries also expire after a while to pick up changes deeper in the tree.
+         * Shared by usage workers, guarded by its own mutex.
+         */
+        struct UsageCache {
+            static constexpr std::size_t max_entries = 4096;
+            static constexpr auto        max_age     = std::chrono::seconds(30);
+
+            bool find(const FileId &id, const DirStamp &stamp, DirUsage &usage) {
+                std::lock_guard lock(mutex);
+                const auto      it = entries.find(id);
+                if (it == entries.end())
+                    return false;
+                if (!(it->second.stamp == stamp) || std::chrono::steady_clock::now() - it->second.at > max_age) {
+                    entries.erase(it);
+                    return false;
+                }
+                usage = it->second.usage;
+                return true;
+            }
+
+            void store(const FileId &id, const DirStamp &stamp, const DirUsage &usage) {
+                if (!stamp.valid)
+                    return;
+                std::lock_guard lock(mutex);
+                if (entries.size() >= max_entries)
+                    entries.clear();
+                entries[id] = { stamp, usage, std::chrono::steady_clock::now() };
+            }
+
+        private:
+            struct Entry {
+                DirStamp                              stamp;
+                DirUsage                              usage;
+                std::chrono::steady_clock::time_point at;
+            };
+
+            std::mutex                                    mutex;
+            std::unordered_map<FileId, Entry, FileIdHash> entries;
+        };
+
+        inline UsageCache &usage_cache() {
+            static UsageCache cache;
+            return cache;
+        }
+
+        /**
+         * Totals are computed on a single idle worker, so they never compete with listings and previews.
+         */
+        inline TaskPool &usage_pool() {
+            // workers use the cache, it has to be constructed first so that it is destroyed after they are joined
+            usage_cache();
+            static TaskPool pool(1);
+            return pool;
+        }
+
+        /**
+         * Lowers CPU and I/O priority of calling thread (linux only).
+         */
+        inline void lower_priority() {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+            thread_local bool lowered = false;
+            if (lowered)
+                return;
+            lowered        = true;
+            const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+            ::setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+            constexpr int ioprio_who_process = 1;
+            constexpr int ioprio_class_idle  = 3 << 13;
+            ::syscall(SYS_ioprio_set, ioprio_who_process, tid, ioprio_class_idle);
+#endif
+#endif
+        }
+
+        struct UsageJob {
+            std::atomic<bool> cancel = false;
+            std::atomic<bool> done   = false;
+
+            std::mutex                                     mutex;
+            std::vector<std::pair<std::string, DirUsage>> pending; // by directory name
+        };
+
+        /**
+         * Change notifications for a single directory (inotify, linux only). Names of changed entries
+         * are collected over several frames and released as one batch once events settle down, so
+         * a burst of thousands of events costs a single update of the listing.
+         */
+        struct DirWatcher {
+            static constexpr int settle_ms    = 50;  // quiet period before batch is released
+            static constexpr int max_delay_ms = 500; // batch is released anyway under constant load
+
+            std::unordered_set<std::string> changed;
+
+            bool resync = false; // events were lost, whole directory has to be compared
+
+            explicit DirWatcher(const fs::path &dir) {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+                fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (fd < 0)
+                    return;
+
+                constexpr std::uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY |
+                                               IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR |
+                                               IN_EXCL_UNLINK;
+                if (::inotify_add_watch(fd, dir.c_str(), mask) < 0) {
+                    ::close(fd);
+                    fd = -1;
+                }
+#else
+                (void) dir;
+#endif
+            }
+
+            ~DirWatcher() {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+                if (fd >= 0)
+                    ::close(fd);
+#endif
+            }
+
+            DirWatcher(const DirWatcher &)            = delete;
+            DirWatcher &operator=(const DirWatcher &) = delete;
+
+            bool active() const {
+                return fd >= 0;
+            }
+
+            /**
+             * Reads all queued events without blocking, has to be called every frame to keep kernel queue short.
+             * @return true if collected batch should be applied now
+             */
+            bool drain() {
+#if defined(__linux__) && !defined(SIMPFP_NO_GETDENTS)
+                if (fd < 0)
+                    return false;
+
+                constexpr std::size_t buffer_size = 64 * 1024;
+                if (buffer == nullptr)
+                    buffer = std::make_unique<char[]>(buffer_size);
+
+                const auto now     = std::chrono::steady_clock::now();
+                const bool pending = resync || !changed.empty();
+
+                bool any = false;
+                for (;;) {
+                    const long read = ::read(fd, buffer.get(), buffer_size);
+                    if (read <= 0)
+                        break;
+
+                    for (long pos = 0; pos < read;) {
+                        const auto event = reinterpret_cast<const inotify_event *>(buffer.get() + pos);
+                        pos += static_cast<long>(sizeof(inotify_event) + event->len);
+                        any = true;
+
+                        if (event->mask & IN_Q_OVERFLOW)
+                            resync = true;
+                        else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+                            lost = true;
+                        else if (event->len > 0 && !resync)
+                            changed.emplace(event->name);
+                    }
+                }
+
+                if (resync)
+                    changed.clear();
+
+                if (lost) {
+                    // directory itself is gone, nothing more will ever be reported
+                    ::close(fd);
+                    fd = -1;
+                }
+
+                if (any) {
+                    if (!pending)
+                        first = now;
+                    last = now;
+                }
+
+                if (!resync && changed.empty())
+                    return false;
+
+                return now - last >= std::chrono::milliseconds(settle_ms) ||
+                       now - first >= std::chrono::milliseconds(max_delay_ms) || fd < 0;
+#else
+                return false;
+#endif
+            }
+
+        private:
+            int  fd   = -1;
+            bool lost = false;
+
+            std::unique_ptr<char[]>               buffer;
+            std::chrono::steady_clock::time_point first;
+            std::chrono::steady_clock::time_point last;
+        };
+
+        /**
+         * Pending work split into per-worker deques: owner takes from the back (depth first, warm caches),
+         * idle workers steal from the front of others, where the oldest and usually largest items are.
+         */
+        template <typename T>
+        struct StealQueues {
+            explicit StealQueues(const std::size_t workers) : queues(workers) {}
+
+            std::size_t size() const {
+                return queues.size();
+            }
+
+            void push(const std::size_t worker, T item) {
+                pending.fetch_add(1);
+                std::lock_guard lock(queues[worker].mutex);
+                queues[worker].items.push_back(std::move(item));
+            }
+
+            /**
+             * Waits for an item, own ones first.
+             * @return false once there is no work left anywhere or <b>stopped</b> returns true
+             */
+            template <typename Stop>
+            bool pop(const std::size_t worker, T &item, Stop &&stopped) {
+                for (int idle = 0;; idle++) {
+                    if (stopped())
+                        return false;
+                    if (take(worker, item, true))
+                        return true;
+                    for (std::size_t k = 1; k < queues.size(); k++)
+                        if (take((worker + k) % queues.size(), item, false))
+                            return true;
+                    if (pending.load() == 0)
+                        return false;
+
+                    if (idle < 64)
+                        std::this_thread::yield();
+                    else
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            }
+
+            /**
+             * Marks popped item as finished, must be called after everything it produced was pushed.
+             */
+            void done() {
+                pending.fetch_sub(1);
+            }
+
+        private:
+            struct Queue {
+                std::mutex    mutex;
+                std::deque<T> items;
+            };
+
+            std::vector<Queue>       queues;
+            std::atomic<std::size_t> pending = 0;
+
+            bool take(const std::size_t index, T &item, const bool back) {
+                auto           &queue = queues[index];
+                std::lock_guard lock(queue.mutex);
+                if (queue.items.empty())
+                    return false;
+                if (back) {
+                    item = std::move(queue.items.back());
+                    queue.items.pop_back();
+                }
+                else {
+                    item = std::move(queue.items.front());
+                    queue.items.pop_front();
+                }
+                return true;
+            }
+        };
+
+        /**
+         * Direct-mapped memo of formatted cells, filled lazily only for rows that are actually drawn.
+         */
+        struct RowCache {
+            static constexpr std::size_t slots = 256;
+
+            struct Row {
+                std::uint32_t id = UINT32_MAX;
+                char          time[20];
+                char          size[24];
+            };
+
+            Row  rows[slots];
+            bool human_size = false;
+
+#ifdef SIMPFP_STATS
+            std::uint64_t format_ns = 0;
+            std::uint64_t formatted = 0;
+#endif
+
+            const Row &get(const Listing &listing, const std::uint32_t id, const bool human_readable) {
+                if (human_readable != human_size) {
+                    invalidate();
+                    human_size = human_readable;
+                }
+
+                Row &row = rows[id % slots];
+                if (row.id != id) {
+                    SIMPFP_STAT(const auto started = std::chrono::steady_clock::now();)
+                    row.id = id;
+                    format_time(listing.mtime[id], row.time);
+                    format_size(listing.size[id], human_size, row.size);
+                    SIMPFP_STAT(format_ns += elapsed_ns(started); formatted++;)
+                }
+                return row;
+            }
+
+            void invalidate() {
+                for (auto &row : rows)
+                    row.id = UINT32_MAX;
+            }
+        };
+
+        struct FileContext {
+            static constexpr std::size_t buffer_size = 256;
+            char                        *buffer      = new char[buffer_size]{};
+
+            const fs::path *path = nullptr;
+
+            Listing                    listing;
+            std::vector<std::uint32_t> dirs;
+            std::vector<std::uint32_t> files;    // rows of files table, sorted narrowed down by search
+            std::vector<std::uint32_t> sorted;   // visible files in sort order
+            std::vector<std::uint32_t> rows;     // row of every entry in files view, built lazily
+            std::vector<std::uint32_t> selected; // in order of selection, mirrors listing.selection
+            std::uint32_t              anchor = UINT32_MAX; // entry range selection starts from
+
+            static constexpr std::size_t search_size = 64;
+            char                         search_buffer[search_size]{};
+
+            std::string                query;  // lowercased search query, empty if not searching
+            std::vector<std::uint32_t> hits;   // files matching query regardless of filters, by id
+            std::vector<std::uint8_t>  scores; // rank of every entry against query, 0 for no match
+
+            std::shared_ptr<LoadJob>    job;
+            std::shared_ptr<Arena>      arena = std::make_shared<Arena>();
+            std::shared_ptr<const Glob> glob;
+            std::unique_ptr<DirWatcher> watcher;
+            RowCache                    cells;
+
+            Settings *settings   = nullptr; // passed on to every context loaded after this one
+            int       filter_idx = 0;
+
+            PhaseStats stats;
+#ifdef SIMPFP_STATS
+            std::chrono::steady_clock::time_point started; // of current load
+#endif
+
+            static constexpr int max_sort = 4;
+
+            SortSpec sort_specs[max_sort];
+            int      sort_count = 0;
+
+            bool accepted = false;
+            bool peeked   = true;
+
+            bool read   = false;
+            bool write  = false;
+            bool hidden = true;
+
+            // recursive listings are filtered while walking, these are the filters used
+            bool                        recursive   = false;
+            bool                        walk_hidden = true;
+            std::shared_ptr<const Glob> walk_glob;
+
+            // recursive totals of listed directories, by name interned in arena
+            std::shared_ptr<UsageJob>                      usage_job;
+            std::unordered_map<std::string_view, DirUsage> usage;
+            bool                                           usage_started = false;
+
+            std::uint32_t prefetched = UINT32_MAX; // directory entry last prefetched
+
+            // listing updated by the watcher is cached again only once changes calm down, not on every batch
+            static constexpr int                  cache_delay_ms = 2000;
+            bool                                  uncached       = false;
+            DirStamp                              uncached_stamp;
+            std::chrono::steady_clock::time_point uncached_at;
+
+            ~FileContext() {
+                if (job != nullptr)
+                    job->cancel = true;
+                if (usage_job != nullptr)
+                    usage_job->cancel = true;
+                if (path != nullptr)
+                    delete path;
+                if (buffer != nullptr)
+                    delete[] buffer;
+            }
+
+            static std::uint8_t permissions(const DirEntry &entry, const Credentials &who) {
+                if (entry.owner)
+                    return who.access(entry);
+
+                // owner unknown on current platform, any class granting access will do
+                const auto   perms = entry.perms;
+                std::uint8_t flags = 0;
+                if ((perms & fs::perms::owner_read) != fs::perms::none ||
+                    (perms & fs::perms::group_read) != fs::perms::none ||
+                    (perms & fs::perms::others_read) != fs::perms::none)
+                    flags |= ENTRY_READ;
+
+                if ((perms & fs::perms::owner_write) != fs::perms::none ||
+                    (perms & fs::perms::group_write) != fs::perms::none ||
+                    (perms & fs::perms::others_write) != fs::perms::none)
+                    flags |= ENTRY_WRITE;
+
+                return flags;
+            }
+
+            static fs::path path_of(const FileContext *context, const std::uint32_t id) {
+                if (context->listing.is(id, ENTRY_PARENT))
+                    return context->path->parent_path();
+                return *context->path / context->listing.name_of(id);
+            }
+
+            static void load(FileContext **context, const char *path, Settings *settings = nullptr) {
+                const auto og_f = load_path(path);
+                const auto file = new fs::path(fs::is_directory(og_f) ? og_f : og_f.parent_path());
+
+                const auto new_context = new FileContext;
+                new_context->settings  = settings;
+                SIMPFP_STAT(new_context->started = std::chrono::steady_clock::now();)
+
+                if (*context != nullptr) {
+                    if (new_context->settings == nullptr)
+                        new_context->settings = (*context)->settings;
+                    new_context->filter_idx = (*context)->filter_idx;
+                    new_context->sort_count = (*context)->sort_count;
+                    std::copy_n((*context)->sort_specs, FileContext::max_sort, new_context->sort_specs);
+                    FileContext::settle(*context, true);
+                    delete *context;
+                }
+
+                new_context->path = file;
+
+                new_context->recursive = new_context->settings->recursive;
+
+                // subscribed before anything is read, so that no change can slip in between
+                if (new_context->settings->watch_dir && !new_context->recursive)
+                    new_context->watcher = std::make_unique<DirWatcher>(*file);
+
+                if (fs::is_regular_file(og_f) && og_f.has_filename()) {
+                    std::memset(new_context->buffer, 0, FileContext::buffer_size);
+                    std::strncpy(new_context->buffer, og_f.filename().c_str(), FileContext::buffer_size - 1);
+                }
+
+                if (const auto cached = new_context->recursive ? nullptr : listing_cache().find(file->native(), dir_stamp(*file));
+                    cached != nullptr) {
+                    new_context->read    = cached->read;
+                    new_context->write   = cached->write;
+                    new_context->listing = cached->listing;
+                    new_context->arena   = cached->arena;
+                    FileContext::refilter(new_context);
+                    SIMPFP_STAT(new_context->stats.load_ns = elapsed_ns(new_context->started);
+                                new_context->stats.bytes   = new_context->listing.bytes() + new_context->arena->bytes();)
+                    *context = new_context;
+                    FileContext::prefetch_parent(new_context);
+                    return;
+                }
+
+                new_context->read  = can_read(*file);
+                new_context->write = can_write(*file);
+
+                const auto stamp = dir_stamp(*file);
+
+                // type id 0 is reserved for entries without extension
+                new_context->listing.types.push_back("");
+
+                if (file->has_parent_path()) {
+                    const auto flags = ENTRY_DIR | ENTRY_PARENT | (can_read(file->parent_path()) ? ENTRY_READ : 0);
+                    new_context->dirs.push_back(new_context->listing.add("..", flags, 0, 0, 0));
+                }
+
+                new_context->glob        = new_context->settings->filter_glob(new_context->filter_idx);
+                new_context->hidden      = new_context->settings->show_hidden;
+                new_context->walk_glob   = new_context->glob;
+                new_context->walk_hidden = new_context->hidden;
+
+                if (new_context->recursive) {
+                    new_context->job        = std::make_shared<LoadJob>();
+                    new_context->job->arena = new_context->arena;
+                    loader_pool().submit([job = new_context->job, dir = *file, glob = new_context->glob,
+                                          hidden = new_context->hidden,
+                                          depth  = new_context->settings->max_depth](const std::atomic<bool> &stop) {
+                        walk(*job, dir, glob, hidden, depth, stop);
+                    });
+                }
+                else if (auto job = prefetcher().adopt(file->native(), stamp); job != nullptr) {
+                    // already enumerated ahead of time
+                    new_context->job   = std::move(job);
+                    new_context->arena = new_context->job->arena;
+                }
+                else {
+                    new_context->job        = std::make_shared<LoadJob>();
+                    new_context->job->arena = new_context->arena;
+                    new_context->job->stamp = stamp;
+                    loader_pool().submit([job = new_context->job, dir = *file](const std::atomic<bool> &stop) {
+                        scan(*job, dir, stop);
+                    });
+                }
+
+                *context = new_context;
+            }
+
+            /**
+             * Loads current directory again, bypassing listing cache since it can not tell
+             * whether files were modified in place.
+             */
+            static void reload(FileContext **context) {
+                (*context)->uncached = false;
+                listing_cache().forget((*context)->path->native());
+                prefetcher().forget((*context)->path->native());
+                FileContext::load(context, (*context)->path->c_str());
+            }
+
+            /**
+             * Worker side of load: enumerates directory and hands entries over to the UI thread in
+             * progressively growing batches, so first rows show up immediately even for huge directories.
+             */
+            static void scan(LoadJob &job, const fs::path &dir, const std::atomic<bool> &stop) {
+                Listing     part;
+                std::size_t batch = LoadJob::first_batch;
+                Arena      &arena = *job.arena;
+                const auto  who   = Credentials::current();
+
+                std::vector<const char *>                         types{ "" };
+                std::unordered_map<std::string_view, std::uint32_t> type_ids{ { "", 0 } };
+
+                const auto publish = [&] {
+                    std::lock_guard lock(job.mutex);
+                    job.pending.append(part);
+                    job.pending.types = types;
+                    part.clear();
+                };
+
+                // listing is kept unfiltered, filters are applied in memory by refilter()
+                const auto want = [](const char *) { return true; };
+
+                const auto emit = [&](const DirEntry &entry) {
+                    if (job.cancel || stop)
+                        return false;
+
+                    SIMPFP_STAT(job.scanned++;)
+                    const std::uint8_t flags = permissions(entry, who);
+
+                    if (entry.dir) {
+                        part.add(entry.name, flags | ENTRY_DIR, 0, 0, 0);
+                    }
+                    else {
+                        const auto ext = arena.intern(extension_of(entry.name));
+                        auto       tid = type_ids.find(ext);
+                        if (tid == type_ids.end()) {
+                            tid = type_ids.emplace(ext, static_cast<std::uint32_t>(types.size())).first;
+                            types.push_back(ext);
+                        }
+
+                        part.add(entry.name, flags, tid->second, entry.size, entry.mtime);
+                    }
+
+                    if (part.count() >= batch) {
+                        publish();
+                        batch = std::min(batch * 2, LoadJob::max_batch);
+                    }
+                    return true;
+                };
+
+                SIMPFP_STAT(const auto started = std::chrono::steady_clock::now(); const auto calls = stat_calls;)
+                enumerate(dir, want, emit);
+                SIMPFP_STAT(job.scan_ns = elapsed_ns(started); job.stat_calls += stat_calls - calls;)
+
+                if (job.cancel || stop)
+                    return;
+
+                publish();
+                job.done = true;
+            }
+
+            /**
+             * Worker side of recursive load: walks the subtree on all cores and streams every accepted file,
+             * named by its path relative to <b>root</b>. Directories are listed for the first level only.
+             * Each directory is entered once, no matter how many hard links or symlinks lead to it.
+             */
+            static void walk(LoadJob &job, const fs::path &root, const std::shared_ptr<const Glob> &glob,
+                             const bool hidden, const int depth_limit, const std::atomic<bool> &stop) {
+                struct Node {
+                    std::string rel; // relative to root, empty for root itself
+                    int         depth = 0;
+                };
+
+                constexpr auto separator = static_cast<char>(fs::path::preferred_separator);
+
+                const std::size_t workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 16);
+                StealQueues<Node> queues(workers);
+
+                std::mutex                             seen_mutex;
+                std::unordered_set<FileId, FileIdHash> seen;
+                std::mutex                             types_mutex;
+                std::vector<const char *>              types{ "" };
+                std::unordered_map<std::string_view, std::uint32_t> type_ids{ { "", 0 } };
+
+                const auto who     = Credentials::current();
+                const auto stopped = [&] { return job.cancel || stop; };
+
+                const auto first_visit = [&](const fs::path &dir, const std::uint64_t dev, const std::uint64_t ino) {
+                    const auto id = FileId::of(dir, dev, ino);
+                    std::lock_guard lock(seen_mutex);
+                    return seen.insert(id).second;
+                };
+
+                const auto root_stamp = dir_stamp(root);
+                first_visit(root, root_stamp.dev, root_stamp.ino);
+                queues.push(0, Node{});
+
+                const auto run = [&](const std::size_t self) {
+                    Listing     part;
+                    std::size_t batch = LoadJob::first_batch;
+                    std::string name;
+
+                    std::unordered_map<std::string_view, std::uint32_t> local_ids{ { "", 0 } };
+
+                    const auto publish = [&] {
+                        std::vector<const char *> snapshot;
+                        {
+                            std::lock_guard lock(types_mutex);
+                            snapshot = types;
+                        }
+                        std::lock_guard lock(job.mutex);
+                        job.pending.append(part);
+                        if (snapshot.size() > job.pending.types.size())
+                            job.pending.types = std::move(snapshot);
+                        part.clear();
+                    };
+
+                    const auto type_id = [&](const char *file) {
+                        const auto ext = extension_of(file);
+                        if (const auto it = local_ids.find(ext); it != local_ids.end())
+                            return it->second;
+
+                        std::lock_guard lock(types_mutex);
+                        auto            it = type_ids.find(ext);
+                        if (it == type_ids.end()) {
+                            const auto interned = job.arena->intern(ext);
+                            it = type_ids.emplace(interned, static_cast<std::uint32_t>(types.size())).first;
+                            types.push_back(interned);
+                        }
+                        local_ids.emplace(it->first, it->second);
+                        return it->second;
+                    };
+
+                    const auto want = [&](const char *file) {
+                        return (hidden || file[0] != '.') && (glob == nullptr || glob->match(file));
+                    };
+
+                    SIMPFP_STAT(const auto calls = stat_calls;)
+
+                    Node node;
+                    while (queues.pop(self, node, stopped)) {
+                        const auto dir    = node.rel.empty() ? root : root / node.rel;
+                        const auto prefix = node.rel.empty() ? std::string() : node.rel + separator;
+
+                        enumerate(dir, want, [&](const DirEntry &entry) {
+                            if (stopped())
+                                return false;
+
+                            SIMPFP_STAT(job.scanned++;)
+                            const std::uint8_t flags = permissions(entry, who);
+
+                            if (entry.dir) {
+                                if (!hidden && entry.name[0] == '.')
+                                    return true;
+                                if (node.depth == 0)
+                                    part.add(entry.name, flags | ENTRY_DIR, 0, 0, 0);
+                                if (node.depth < depth_limit && first_visit(dir / entry.name, entry.dev, entry.ino))
+                                    queues.push(self, Node{ prefix + entry.name, node.depth + 1 });
+                            }
+                            else {
+                                name.assign(prefix).append(entry.name);
+                                part.add(name.c_str(), flags, type_id(name.c_str()), entry.size, entry.mtime);
+                            }
+
+                            if (part.count() >= batch) {
+                                publish();
+                                batch = std::min(batch * 2, LoadJob::max_batch);
+                            }
+                            return true;
+                        });
+
+                        queues.done();
+                    }
+
+                    publish();
+                    SIMPFP_STAT(job.stat_calls += stat_calls - calls;)
+                };
+
+                SIMPFP_STAT(const auto started = std::chrono::steady_clock::now();)
+
+                std::vector<std::thread> threads;
+                for (std::size_t i = 1; i < workers; i++)
+                    threads.emplace_back(run, i);
+                run(0);
+                for (auto &thread : threads)
+                    thread.join();
+
+                SIMPFP_STAT(job.scan_ns = elapsed_ns(started);)
+
+                if (!stopped())
+                    job.done = true;
+            }
+
+            /**
+             * Merges entries published by the background scan, must be called from the UI thread.
+             * @return true if listing changed
+             */
+            static bool poll(FileContext *context) {
+                prefetcher().trim();
+
+                if (context->job == nullptr) {
+                    const bool changed = FileContext::watch(context);
+                    return FileContext::poll_usage(context) || changed;
+                }
+
+                // changes are only collected during the scan and applied once it is done
+                if (context->watcher != nullptr)
+                    context->watcher->drain();
+
+                Listing    part;
+                const bool done = context->job->done;
+                {
+                    std::lock_guard lock(context->job->mutex);
+                    std::swap(part, context->job->pending);
+                }
+
+                const auto job = context->job;
+                if (done)
+                    context->job = nullptr;
+
+                auto &listing = context->listing;
+                if (!part.empty()) {
+                    auto id = listing.count();
+                    listing.append(part);
+                    // recursive walkers publish concurrently, type table only ever grows
+                    if (part.types.size() > listing.types.size())
+                        listing.types = part.types;
+
+                    FileContext::match(context, id);
+                    for (; id < listing.count(); id++)
+                        if (visible(context, id))
+                            (listing.is(id, ENTRY_DIR) ? context->dirs : context->sorted).push_back(id);
+
+                    FileContext::resort(context);
+                }
+
+                if (done) {
+                    listing_cache().store(context->path->native(), job->stamp, listing, context->arena, context->read,
+                                          context->write);
+                    SIMPFP_STAT(context->stats.load_ns    = elapsed_ns(context->started);
+                                context->stats.scan_ns    = job->scan_ns;
+                                context->stats.scanned    = job->scanned;
+                                context->stats.stat_calls = job->stat_calls;
+                                context->stats.bytes      = listing.bytes() + context->arena->bytes();)
+                    FileContext::prefetch_parent(context);
+                }
+
+                return !part.empty();
+            }
+
+            /**
+             * Enumerates given directory ahead of time on the prefetch worker, unless it is cached already.
+             * The listing is handed over by load() once the directory is entered.
+             */
+            static void prefetch(const Settings &settings, const fs::path &dir) {
+                if (!settings.prefetch || listing_cache().contains(dir.native()))
+                    return;
+
+                const auto job = prefetcher().start(dir.native());
+                if (job == nullptr)
+                    return;
+
+                prefetch_pool().submit([job, dir](const std::atomic<bool> &stop) {
+                    if (job->cancel || stop)
+                        return;
+                    lower_priority();
+                    job->stamp = dir_stamp(dir);
+                    scan(*job, dir, stop);
+                });
+            }
+
+            /**
+             * Prefetches listed directory the user is pointing at (hovered or focused), once per entry.
+             */
+            static void prefetch(FileContext *context, const std::uint32_t id) {
+                if (context->recursive || context->prefetched == id || !context->listing.is(id, ENTRY_READ))
+                    return;
+                context->prefetched = id;
+                FileContext::prefetch(*context->settings, FileContext::path_of(context, id));
+            }
+
+            static void prefetch_parent(FileContext *context) {
+                if (context->recursive || !context->path->has_parent_path())
+                    return;
+                if (const auto parent = context->path->parent_path(); parent != *context->path)
+                    FileContext::prefetch(*context->settings, parent);
+            }
+
+            /**
+             * Starts computing totals of listed directories on the usage worker, in listing order.
+             */
+            static void measure(FileContext *context) {
+                context->usage_started = true;
+
+                std::vector<std::string> names;
+                for (const auto id : context->dirs)
+                    if (!context->listing.is(id, ENTRY_PARENT))
+                        names.emplace_back(context->listing.name_of(id), context->listing.length_of(id));
+                if (names.empty())
+                    return;
+
+                context->usage_job = std::make_shared<UsageJob>();
+                usage_pool().submit([job = context->usage_job, dir = *context->path,
+                                     names = std::move(names)](const std::atomic<bool> &stop) {
+                    lower_priority();
+                    const auto stopped = [&] { return job->cancel || stop; };
+
+                    for (const auto &name : names) {
+                        if (stopped())
+                            return;
+
+                        const auto path = dir / name;
+
+                        // listed links to directories are not followed either, one could lead to root
+                        std::error_code ec;
+                        if (fs::is_symlink(path, ec))
+                            continue;
+
+                        const auto stamp = dir_stamp(path);
+                        const auto id    = FileId::of(path, stamp.dev, stamp.ino);
+
+                        DirUsage usage;
+                        if (!usage_cache().find(id, stamp, usage)) {
+                            if (!dir_usage(path, usage, stopped))
+                                return;
+                            usage_cache().store(id, stamp, usage);
+                        }
+
+                        std::lock_guard lock(job->mutex);
+                        job->pending.emplace_back(name, usage);
+                    }
+                    job->done = true;
+                });
+            }
+
+            /**
+             * Merges directory totals computed so far, computation starts once listing is complete.
+             * @return true if any totals arrived
+             */
+            static bool poll_usage(FileContext *context) {
+                if (!context->settings->dir_sizes || context->job != nullptr)
+                    return false;
+                if (!context->usage_started)
+                    FileContext::measure(context);
+
+                const auto job = context->usage_job;
+                if (job == nullptr)
+                    return false;
+
+                std::vector<std::pair<std::string, DirUsage>> part;
+                const bool                                    done = job->done;
+                {
+                    std::lock_guard lock(job->mutex);
+                    std::swap(part, job->pending);
+                }
+                if (done)
+                    context->usage_job = nullptr;
+
+                for (const auto &[name, usage] : part)
+                    context->usage[context->arena->intern(name.c_str())] = usage;
+                return !part.empty();
+            }
+
+            static bool watching(const FileContext *context) {
+                return context->watcher != nullptr && context->watcher->active();
+            }
+
+            /**
+             * Applies batch of changes reported by directory watcher to the listing in place.
+             * Sort order, selection of surviving entries and scroll position are kept.
+             * @return true if listing changed
+             */
+            static bool watch(FileContext *context) {
+                const auto &watcher = context->watcher;
+                if (watcher == nullptr || !watcher->drain()) {
+                    FileContext::settle(context, false);
+                    return false;
+                }
+
+                const auto &dir   = *context->path;
+                const auto  stamp = dir_stamp(dir);
+                watcher->drain(); // anything that happened before the stamp has to be part of this batch
+
+                auto      &listing = context->listing;
+                Arena     &arena   = *context->arena;
+                const auto count   = listing.count();
+
+                std::unordered_map<std::string_view, std::uint32_t> ids;
+                ids.reserve(count);
+                for (std::uint32_t id = 0; id < count; id++)
+                    if (!listing.is(id, ENTRY_PARENT))
+                        ids.emplace(std::string_view(listing.name_of(id), listing.length_of(id)), id);
+
+                const auto                who = Credentials::current();
+                std::vector<std::uint8_t> gone(count, watcher->resync ? 1 : 0);
+                std::vector<std::string>  added_names;
+                std::vector<DirEntry>     added;
+                bool                      changed  = false;
+                bool                      deselect = false;
+
+                // built on first use, most batches only touch directories or known types
+                std::unordered_map<std::string_view, std::uint32_t> type_ids;
+                const auto type_id = [&](const char *name) {
+                    if (type_ids.empty())
+                        for (std::size_t i = 0; i < listing.types.size(); i++)
+                            type_ids.emplace(listing.types[i], static_cast<std::uint32_t>(i));
+
+                    const auto ext = extension_of(name);
+                    auto       it  = type_ids.find(ext);
+                    if (it == type_ids.end()) {
+                        const auto interned = arena.intern(ext);
+                        it = type_ids.emplace(interned, static_cast<std::uint32_t>(listing.types.size())).first;
+                        listing.types.push_back(interned);
+                    }
+                    return it->second;
+                };
+
+                const auto apply = [&](const DirEntry &entry) {
+                    const auto it = ids.find(entry.name);
+                    if (it == ids.end()) {
+                        added_names.emplace_back(entry.name);
+                        added.push_back(entry);
+                        return true;
+                    }
+
+                    const auto         id    = it->second;
+                    const std::uint8_t flags = permissions(entry, who) | (entry.dir ? ENTRY_DIR : 0);
+                    gone[id]                 = 0;
+
+                    // only files can be selected
+                    if (entry.dir && listing.selected(id)) {
+                        listing.select(id, false);
+                        deselect = true;
+                    }
+
+                    listing.flags[id] = flags;
+                    listing.type[id]  = entry.dir ? 0 : type_id(entry.name);
+                    listing.size[id]  = entry.size;
+                    listing.mtime[id] = entry.mtime;
+                    changed           = true;
+                    return true;
+                };
+
+                if (watcher->resync) {
+                    enumerate(dir, [](const char *) { return true; }, apply);
+                    watcher->resync = false;
+                    watcher->changed.clear();
+                }
+
+                for (const auto &name : watcher->changed) {
+                    DirEntry entry;
+                    if (stat_entry(dir, name.c_str(), entry))
+                        apply(entry);
+                    else if (const auto it = ids.find(name); it != ids.end())
+                        gone[it->second] = 1;
+                }
+                watcher->changed.clear();
+
+                for (std::uint32_t id = 0; id < count; id++)
+                    if (listing.is(id, ENTRY_PARENT))
+                        gone[id] = 0;
+
+                if (std::find(gone.begin(), gone.end(), 1) != gone.end()) {
+                    // entries are addressed by position, so removal means compacting the whole listing
+                    Listing next;
+                    next.types = listing.types;
+
+                    std::vector<std::uint32_t> remap(count, UINT32_MAX);
+                    for (std::uint32_t id = 0; id < count; id++) {
+                        if (gone[id])
+                            continue;
+                        remap[id] = next.add(listing.name_of(id), listing.flags[id], listing.type[id],
+                                             listing.size[id], listing.mtime[id]);
+                        if (listing.selected(id))
+                            next.select(remap[id], true);
+                    }
+
+                    for (auto &id : context->selected)
+                        id = remap[id];
+                    if (context->anchor != UINT32_MAX)
+                        context->anchor = remap[context->anchor];
+                    if (context->prefetched != UINT32_MAX)
+                        context->prefetched = remap[context->prefetched];
+
+                    listing = std::move(next);
+                    changed = true;
+                }
+
+                if (deselect || listing.count() != count) {
+                    auto      &selected = context->selected;
+                    const auto size     = selected.size();
+                    selected.erase(std::remove_if(selected.begin(), selected.end(),
+                                                  [&listing](const std::uint32_t id) {
+                                                      return id == UINT32_MAX || !listing.selected(id);
+                                                  }),
+                                   selected.end());
+                    deselect = selected.size() != size;
+                }
+
+                for (std::size_t i = 0; i < added.size(); i++) {
+                    auto &entry = added[i];
+                    entry.name  = added_names[i].c_str();
+
+                    const std::uint8_t flags = permissions(entry, who) | (entry.dir ? ENTRY_DIR : 0);
+                    listing.add(entry.name, flags, entry.dir ? 0 : type_id(entry.name), entry.size, entry.mtime);
+                    changed = true;
+                }
+
+                if (!changed)
+                    return false;
+
+                context->cells.invalidate();
+                if (!context->query.empty()) {
+                    // ids might have moved, so previous matches mean nothing
+                    context->hits.clear();
+                    context->scores.assign(listing.count(), 0);
+                    FileContext::match(context, 0);
+                }
+                if (FileContext::refilter(context) || deselect)
+                    FileContext::update_buffer(context);
+
+                // copying the whole listing on every batch would cost more than the update itself
+                if (!context->uncached)
+                    listing_cache().forget(dir.native());
+                context->uncached       = true;
+                context->uncached_stamp = stamp;
+                context->uncached_at    = std::chrono::steady_clock::now();
+                return true;
+            }
+
+            /**
+             * Stores listing updated by the watcher into listing cache, once no change came in for a while.
+             * @param now store right away, ie: directory is being left
+             */
+            static void settle(FileContext *context, const bool now) {
+                if (!context->uncached || context->job != nullptr)
+                    return;
+                if (!now && std::chrono::steady_clock::now() - context->uncached_at <
+                                    std::chrono::milliseconds(FileContext::cache_delay_ms))
+                    return;
+
+                context->uncached = false;
+                listing_cache().store(context->path->native(), context->uncached_stamp, context->listing,
+                                      context->arena, context->read, context->write);
+            }
+
+            static bool visible(const FileContext *context, const std::uint32_t id) {
+                const auto &listing = context->listing;
+                if (listing.is(id, ENTRY_PARENT))
+                    return true;
+
+                const char *name = listing.name_of(id);
+                const char *base = basename_of(name);
+                if (!context->hidden && base[0] == '.')
+                    return false;
+                if (listing.is(id, ENTRY_DIR) || context->glob == nullptr)
+                    return true;
+                return context->glob->match(base, listing.length_of(id) - static_cast<std::size_t>(base - name));
+            }
+
+            /**
+             * Rebuilds dirs and files views from the unfiltered listing using current filter and
+             * hidden files mode, no filesystem access involved. Sort order is re-applied and
+             * selection is kept for entries which are still visible.
+             * @return true if selection changed
+             */
+            static bool refilter(FileContext *context) {
+                SIMPFP_STAT(const StatTimer timer(context->stats.filter_ns);)
+                context->glob   = context->settings->filter_glob(context->filter_idx);
+                context->hidden = context->settings->show_hidden;
+
+                context->dirs.clear();
+                context->sorted.clear();
+
+                const auto &listing = context->listing;
+                for (std::uint32_t id = 0; id < listing.count(); id++)
+                    if (visible(context, id))
+                        (listing.is(id, ENTRY_DIR) ? context->dirs : context->sorted).push_back(id);
+
+                FileContext::resort(context);
+
+                auto      &selected = context->selected;
+                const auto size     = selected.size();
+                selected.erase(std::remove_if(selected.begin(), selected.end(),
+                                              [context](const std::uint32_t id) {
+                                                  if (visible(context, id))
+                                                      return false;
+                                                  context->listing.select(id, false);
+                                                  return true;
+                                              }),
+                               selected.end());
+                return selected.size() != size;
+            }
+
+            /**
+             * @return true if current filters can only be applied by loading again, which is the case
+             * for recursive listings as those are filtered while walking
+             */
+            static bool stale(const FileContext *context) {
+                return context->recursive &&
+                       (context->settings->filter_glob(context->filter_idx) != context->walk_glob ||
+                        context->settings->show_hidden != context->walk_hidden);
+            }
+
+            /**
+             * Applies changed filter or hidden files mode to the views.
+             */
+            static void apply_filters(FileContext **context) {
+                if (stale(*context)) {
+                    reload(context);
+                    return;
+                }
+                if (refilter(*context))
+                    update_buffer(*context);
+            }
+
+            /**
+             * Setters of model settings, each one applied to current listing (if any) in the cheapest way.
+             */
+            static void set_icase(Settings &settings, FileContext **context, const bool enable) {
+                if (settings.filter_icase == enable)
+                    return;
+                settings.filter_icase = enable;
+                settings.compile_filters();
+                if (*context != nullptr)
+                    apply_filters(context);
+            }
+
+            static void set_hidden(Settings &settings, FileContext **context, const bool enable) {
+                settings.show_hidden = enable;
+                if (*context != nullptr)
+                    apply_filters(context);
+            }
+
+            static void set_natural(Settings &settings, FileContext **context, const bool enable) {
+                if (settings.natural_sort == enable)
+                    return;
+                settings.natural_sort = enable;
+                if (*context != nullptr)
+                    resort(*context);
+            }
+
+            static void set_watch(Settings &settings, FileContext **context, const bool enable) {
+                settings.watch_dir = enable;
+                if (*context == nullptr)
+                    return;
+
+                if (!enable)
+                    (*context)->watcher = nullptr;
+                else if ((*context)->watcher == nullptr && !(*context)->recursive) {
+                    (*context)->watcher = std::make_unique<DirWatcher>(*(*context)->path);
+                    // whatever happened before subscription is unknown
+                    (*context)->watcher->resync = true;
+                }
+            }
+
+            static void set_dir_sizes(Settings &settings, FileContext **context, const bool enable) {
+                settings.dir_sizes = enable;
+                if (*context == nullptr || enable)
+                    return;
+
+                if ((*context)->usage_job != nullptr)
+                    (*context)->usage_job->cancel = true;
+                (*context)->usage_job     = nullptr;
+                (*context)->usage_started = false;
+                (*context)->usage.clear();
+            }
+
+            static void set_prefetch(Settings &settings, const bool enable) {
+                settings.prefetch = enable;
+                if (!enable)
+                    prefetcher().clear();
+            }
+
+            static void set_recursive(Settings &settings, FileContext **context, const bool enable, const int max_depth) {
+                const bool changed = settings.recursive != enable || (enable && settings.max_depth != max_depth);
+                settings.recursive = enable;
+                settings.max_depth = std::max(max_depth, 0);
+                if (*context != nullptr && changed)
+                    reload(context);
+            }
+
+            /**
+             * Fills input buffer with name of selected file, or with a summary ("N files selected: a; b; ...")
+             * if there are more of them. Only names which fit into the buffer are ever looked at,
+             * complete results are available through for_each_selected().
+             */
+            static void update_buffer(FileContext *context) {
+                constexpr std::size_t max_len = FileContext::buffer_size - 1;
+
+                char *buffer = context->buffer;
+                std::memset(buffer, 0, FileContext::buffer_size);
+
+                const auto &selected = context->selected;
+                const auto &listing  = context->listing;
+
+                if (selected.size() == 1) {
+                    std::strncpy(buffer, listing.name_of(selected[0]), std::min(max_len, listing.length_of(selected[0])));
+                    return;
+                }
+
+                if (selected.empty())
+                    return;
+
+                char      *out  = buffer;
+                const auto end  = buffer + max_len;
+                bool       full = false;
+                const auto put  = [&](const char *str, const std::size_t len) {
+                    const auto n = std::min(len, static_cast<std::size_t>(end - out));
+                    std::memcpy(out, str, n);
+                    out += n;
+                    full = n < len;
+                };
+
+                char digits[20];
+                put(digits, write_digits(digits, selected.size(), 0) - digits);
+                put(" ", 1);
+                put(context->settings->selected, std::strlen(context->settings->selected));
+                put(": ", 2);
+
+                std::size_t k = 0;
+                for (; k < selected.size() && !full; k++) {
+                    if (k > 0)
+                        put("; ", 2);
+                    put(listing.name_of(selected[k]), listing.length_of(selected[k]));
+                }
+
+                if (full || k < selected.size())
+                    std::memcpy(end - 3, "...", 3);
+            }
+
+            /**
+             * Calls <b>callback</b> with absolute path of every selected entry, in order of selection.
+             * Path buffer is reused, so there is no allocation per entry.
+             * @return number of reported paths
+             */
+            template <typename Callback>
+            static std::size_t for_each_selected(const FileContext *context, Callback &&callback) {
+                std::string path = context->path->native();
+                if (!path.empty() && path.back() != fs::path::preferred_separator)
+                    path.push_back(fs::path::preferred_separator);
+
+                const std::size_t prefix = path.size();
+                std::size_t       count  = 0;
+                for (const auto id : context->selected) {
+                    path.resize(prefix);
+                    path.append(context->listing.name_of(id), context->listing.length_of(id));
+                    count++;
+                    if (!callback(path.c_str()))
+                        break;
+                }
+                return count;
+            }
+
+            /**
+             * Packs absolute paths of selected files into one block, sized up front so views into it stay put.
+             * @param names names relative to current directory, selection if empty
+             */
+            static PathSpan collect(const FileContext *context, std::string &block, std::vector<std::string_view> &views,
+                                    const std::vector<std::string_view> &names = {}) {
+                const auto &dir    = context->path->native();
+                const bool  sep    = !dir.empty() && dir.back() != fs::path::preferred_separator;
+                const auto  prefix = dir.size() + (sep ? 1 : 0);
+                const auto  count  = names.empty() ? context->selected.size() : names.size();
+
+                const auto name = [&](const std::size_t i) {
+                    if (!names.empty())
+                        return names[i];
+                    const auto id = context->selected[i];
+                    return std::string_view(context->listing.name_of(id), context->listing.length_of(id));
+                };
+
+                std::size_t total = 0;
+                for (std::size_t i = 0; i < count; i++)
+                    total += prefix + name(i).size() + 1;
+
+                block.clear();
+                block.reserve(total);
+                views.clear();
+                views.reserve(count);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    const auto start = block.size();
+                    block.append(dir);
+                    if (sep)
+                        block.push_back(fs::path::preferred_separator);
+                    block.append(name(i));
+                    views.emplace_back(block.data() + start, block.size() - start);
+                    block.push_back('\0');
+                }
+
+                return { views.data(), views.size() };
+            }
+
+            static bool loading(const FileContext *context) {
+                return context->job != nullptr;
+            }
+
+            static int files_num(const FileContext *context) {
+                return static_cast<int>(context->files.size());
+            }
+
+            static int dirs_num(const FileContext *context) {
+                return static_cast<int>(context->dirs.size());
+            }
+
+            /**
+             * @return row of given entry in files view, or -1
+             */
+            static int row_of(FileContext *context, const std::uint32_t id) {
+                auto &rows = context->rows;
+                if (rows.empty() && !context->files.empty()) {
+                    rows.assign(context->listing.count(), UINT32_MAX);
+                    for (std::size_t i = 0; i < context->files.size(); i++)
+                        rows[context->files[i]] = static_cast<std::uint32_t>(i);
+                }
+
+                if (id >= rows.size() || rows[id] == UINT32_MAX)
+                    return -1;
+                return static_cast<int>(rows[id]);
+            }
+
+            /**
+             * Invalidates row index after files view changed, it is rebuilt on next row_of().
+             */
+            static void reindex(FileContext *context) {
+                context->rows.clear();
+            }
+
+            /**
+             * Drops whole selection, cost depends on the number of selected entries rather than listing size.
+             */
+            static void clear_selected(FileContext *context) {
+                auto &listing = context->listing;
+                if (context->selected.size() > listing.selection.size())
+                    listing.clear_selection();
+                else
+                    for (const auto id : context->selected)
+                        listing.select(id, false);
+                context->selected.clear();
+            }
+
+            static bool selectable(const FileContext *context, const std::uint32_t id) {
+                const auto &listing = context->listing;
+                return listing.is(id, ENTRY_READ) && (listing.is(id, ENTRY_WRITE) || context->settings->read_only);
+            }
+
+            static void select_id(FileContext *context, const std::uint32_t id) {
+                if (context->listing.selected(id))
+                    return;
+                context->listing.select(id, true);
+                context->selected.push_back(id);
+            }
+
+            static void select_single(FileContext *context, const int index) {
+                const auto id   = context->files[index];
+                context->anchor = id;
+                if (context->selected.size() == 1 && context->listing.selected(id))
+                    return;
+
+                clear_selected(context);
+                select_id(context, id);
+            }
+
+            static void unselect_all(FileContext *context) {
+                if (context->selected.size() > 1)
+                    std::memset(context->buffer, 0, FileContext::buffer_size);
+                clear_selected(context);
+                context->anchor = UINT32_MAX;
+            }
+
+            static void select_add(FileContext *context, const int index) {
+                context->anchor = context->files[index];
+                select_id(context, context->anchor);
+            }
+
+            static void select_toggle(FileContext *context, const int index) {
+                const auto id   = context->files[index];
+                context->anchor = id;
+                if (!context->listing.selected(id)) {
+                    select_id(context, id);
+                    return;
+                }
+
+                context->listing.select(id, false);
+                auto &selected = context->selected;
+                selected.erase(std::find(selected.begin(), selected.end(), id));
+            }
+
+            /**
+             * Selects every row between the anchor (last clicked entry) and given row.
+             * @param extend keep current selection instead of replacing it
+             */
+            static void select_range(FileContext *context, const int index, const bool extend = false) {
+                const int row = row_of(context, context->anchor);
+                if (row < 0) {
+                    extend ? select_add(context, index) : select_single(context, index);
+                    return;
+                }
+
+                if (!extend)
+                    clear_selected(context);
+
+                const int from = std::min(row, index);
+                const int to   = std::max(row, index);
+                for (int i = from; i <= to; i++)
+                    if (selectable(context, context->files[i]))
+                        select_id(context, context->files[i]);
+            }
+
+            static void select_all(FileContext *context) {
+                context->selected.reserve(context->files.size());
+                for (const auto id : context->files)
+                    if (selectable(context, id))
+                        select_id(context, id);
+            }
+
+            /**
+             * Inverts selection within files view, entries hidden by search stay as they are.
+             */
+            static void select_invert(FileContext *context) {
+                auto &listing  = context->listing;
+                auto &selected = context->selected;
+
+                std::vector<std::uint32_t> flip;
+                for (const auto id : context->files) {
+                    if (listing.selected(id))
+                        listing.select(id, false);
+                    else if (selectable(context, id))
+                        flip.push_back(id);
+                }
+
+                selected.erase(std::remove_if(selected.begin(), selected.end(),
+                                              [&listing](const std::uint32_t id) { return !listing.selected(id); }),
+                               selected.end());
+                for (const auto id : flip)
+                    select_id(context, id);
+            }
+
+            /**
+             * Replaces selection with every visible file matching given glob.
+             */
+            static void select_matching(FileContext *context, const Glob &glob) {
+                const auto &listing = context->listing;
+                clear_selected(context);
+                for (const auto id : context->files)
+                    if (selectable(context, id) && glob.match(listing.name_of(id), listing.length_of(id)))
+                        select_id(context, id);
+            }
+
+            /**
+             * Replaces selection with every visible file matching given glob pattern.
+             * @return number of selected files, or -1 if pattern is invalid
+             */
+            static long select_matching(FileContext *context, const char *glob) {
+                Glob matcher;
+                if (!matcher.compile(glob, context->settings->filter_icase))
+                    return -1;
+                select_matching(context, matcher);
+                return static_cast<long>(context->selected.size());
+            }
+
+            static void sort(FileContext *context, const char by, const char order) {
+                const SortSpec spec{ by, order };
+                sort(context, &spec, 1);
+            }
+
+            /**
+             * Stable multi-column sort of the files view, entries themselves are never moved so
+             * selection survives. Primary column is sorted on precomputed integer keys, remaining
+             * columns are only consulted on ties.
+             */
+            static void sort(FileContext *context, const SortSpec *specs, const int count) {
+                context->sort_count = 0;
+                for (int i = 0; i < count && context->sort_count < max_sort; i++)
+                    if (specs[i].by > 0 && specs[i].order > 0)
+                        context->sort_specs[context->sort_count++] = specs[i];
+
+                resort(context);
+            }
+
+            /**
+             * Re-applies sort specs to the files view and refreshes row index.
+             */
+            static void resort(FileContext *context) {
+                SIMPFP_STAT(const StatTimer timer(context->stats.sort_ns);)
+                if (context->sort_count <= 0) {
+                    narrow(context);
+                    return;
+                }
+
+                const auto &l     = context->listing;
+                auto       &files = context->sorted;
+                const auto *specs = context->sort_specs;
+                const int   count = context->sort_count;
+
+                const bool natural = context->settings->natural_sort;
+
+                // rank of every extension in strcmp (or natural) order, so that type compares as integers
+                std::vector<std::uint32_t> rank(l.types.size());
+                {
+                    std::vector<std::uint32_t> order(l.types.size());
+                    for (std::size_t i = 0; i < order.size(); i++)
+                        order[i] = static_cast<std::uint32_t>(i);
+
+                    if (natural) {
+                        std::vector<std::vector<char>> keys(l.types.size());
+                        for (std::size_t i = 0; i < keys.size(); i++)
+                            Listing::collate(l.types[i], std::strlen(l.types[i]), keys[i]);
+                        std::sort(order.begin(), order.end(), [&](const std::uint32_t a, const std::uint32_t b) {
+                            const int r = Listing::compare_collation({ keys[a].data(), keys[a].size() },
+                                                                     { keys[b].data(), keys[b].size() });
+                            return r != 0 ? r < 0 : std::strcmp(l.types[a], l.types[b]) < 0;
+                        });
+                    }
+                    else {
+                        std::sort(order.begin(), order.end(), [&l](const std::uint32_t a, const std::uint32_t b) {
+                            return std::strcmp(l.types[a], l.types[b]) < 0;
+                        });
+                    }
+                    for (std::size_t i = 0; i < order.size(); i++)
+                        rank[order[i]] = static_cast<std::uint32_t>(i);
+                }
+
+                const auto key_of = [&](const char by, const std::uint32_t id) -> std::uint64_t {
+                    switch (by) {
+                        case SORT_NAME:
+                            return natural ? l.coll_key[id] : l.name_key[id];
+                        case SORT_SIZE:
+                            return l.size[id];
+                        case SORT_TYPE:
+                            return rank[l.type[id]];
+                        case SORT_TIME:
+                            return static_cast<std::uint64_t>(l.mtime[id]) ^ (std::uint64_t{ 1 } << 63);
+                        default:
+                            return 0;
+                    }
+                };
+
+                const auto compare = [&](const SortSpec &spec, const std::uint32_t a, const std::uint32_t b) {
+                    int r;
+                    if (spec.by == SORT_NAME && natural) {
+                        const auto ka = l.coll_key[a], kb = l.coll_key[b];
+                        if (ka != kb)
+                            r = ka < kb ? -1 : 1;
+                        else if ((r = Listing::compare_collation(l.collation_of(a), l.collation_of(b))) == 0)
+                            r = std::strcmp(l.name_of(a), l.name_of(b));
+                    }
+                    else if (spec.by == SORT_NAME) {
+                        const auto ka = l.name_key[a], kb = l.name_key[b];
+                        if (ka != kb)
+                            r = ka < kb ? -1 : 1;
+                        else
+                            r = l.length_of(a) < 8 ? 0 : std::strcmp(l.name_of(a) + 8, l.name_of(b) + 8);
+                    }
+                    else {
+                        const auto ka = key_of(spec.by, a), kb = key_of(spec.by, b);
+                        r = (ka > kb) - (ka < kb);
+                    }
+                    return spec.order == SORT_DSC ? -r : r;
+                };
+
+                struct Item {
+                    std::uint64_t key;
+                    std::uint32_t id;
+                };
+
+                const bool        desc = specs[0].order == SORT_DSC;
+                std::vector<Item> items(files.size());
+                for (std::size_t i = 0; i < files.size(); i++) {
+                    const auto key = key_of(specs[0].by, files[i]);
+                    items[i]       = { desc ? ~key : key, files[i] };
+                }
+
+                std::stable_sort(items.begin(), items.end(), [&](const Item &a, const Item &b) {
+                    if (a.key != b.key)
+                        return a.key < b.key;
+                    for (int i = 0; i < count; i++) {
+                        // primary column already compared equal on its key, only names need a second look
+                        if (i == 0 && specs[0].by != SORT_NAME)
+                            continue;
+                        if (const int r = compare(specs[i], a.id, b.id); r != 0)
+                            return r < 0;
+                    }
+                    return false;
+                });
+
+                for (std::size_t i = 0; i < files.size(); i++)
+                    files[i] = items[i].id;
+
+                narrow(context);
+            }
+
+            /**
+             * Narrows files view down to entries matching search query, ranked by match quality
+             * with sort order kept among equally ranked ones.
+             */
+            static void narrow(FileContext *context) {
+                if (context->query.empty()) {
+                    context->files = context->sorted;
+                    reindex(context);
+                    return;
+                }
+
+                // counting sort by rank, stable and linear no matter how many entries match
+                const auto &scores = context->scores;
+                std::size_t starts[256]{};
+                for (const auto id : context->sorted)
+                    if (scores[id] > 0)
+                        starts[255 - scores[id]]++;
+
+                std::size_t total = 0;
+                for (auto &start : starts) {
+                    const auto count = start;
+                    start            = total;
+                    total += count;
+                }
+
+                auto &files = context->files;
+                files.resize(total);
+                for (const auto id : context->sorted)
+                    if (scores[id] > 0)
+                        files[starts[255 - scores[id]]++] = id;
+
+                reindex(context);
+            }
+
+            /**
+             * Scores files with id starting at <b>from</b> against current query, used as entries arrive.
+             */
+            static void match(FileContext *context, const std::uint32_t from) {
+                if (context->query.empty())
+                    return;
+
+                const auto   &l     = context->listing;
+                const auto    mask  = signature(context->query);
+                const auto    count = l.count();
+                context->scores.resize(count, 0);
+
+                for (std::uint32_t id = from; id < count; id++) {
+                    if (l.is(id, ENTRY_DIR) || (l.chars[id] & mask) != mask)
+                        continue;
+                    const int score = fuzzy_score({ l.lower_of(id), l.length_of(id) }, context->query);
+                    if (score > 0) {
+                        context->scores[id] = static_cast<std::uint8_t>(score);
+                        context->hits.push_back(id);
+                    }
+                }
+            }
+
+            static std::uint64_t signature(const std::string &query) {
+                std::uint64_t mask = 0;
+                for (const char c : query)
+                    mask |= Listing::signature(c);
+                return mask;
+            }
+
+            /**
+             * Type-ahead search over current listing, applied on top of filters.
+             * A query extending the previous one only re-checks previous hits.
+             * @return true if files view changed
+             */
+            static bool search(FileContext *context, const char *text) {
+                SIMPFP_STAT(const StatTimer timer(context->stats.search_ns);)
+                std::string query;
+                for (const char *c = text; c != nullptr && *c != '\0'; c++)
+                    query.push_back(Listing::to_lower(*c));
+
+                if (query == context->query)
+                    return false;
+
+                const bool refine = !context->query.empty() && query.compare(0, context->query.size(), context->query) == 0;
+                context->query    = std::move(query);
+
+                auto &scores = context->scores;
+                auto &hits   = context->hits;
+
+                if (!refine) {
+                    for (const auto id : hits)
+                        scores[id] = 0;
+                    hits.clear();
+                    FileContext::match(context, 0);
+                }
+                else {
+                    const auto &l    = context->listing;
+                    const auto  mask = signature(context->query);
+                    std::size_t kept = 0;
+                    for (const auto id : hits) {
+                        int score = 0;
+                        if ((l.chars[id] & mask) == mask)
+                            score = fuzzy_score({ l.lower_of(id), l.length_of(id) }, context->query);
+                        scores[id] = static_cast<std::uint8_t>(score);
+                        if (score > 0)
+                            hits[kept++] = id;
+                    }
+                    hits.resize(kept);
+                }
+
+                FileContext::narrow(context);
+                return true;
+            }
+        };
+
+    } // namespace internal_
+
+    /**
+     * Headless directory model: background loading, filters, sorting, search, selection and results,
+     * without any UI. The file dialog is a view over the same model, this is the way to drive it
+     * from tests, benchmarks or command line tools.
+     * <br/>Not thread-safe. Listing cache, prefetched listings and previews are shared by every model and
+     * dialog in the process, so all of them have to be driven from one and the same thread.
+     */
+    class DirectoryModel {
+    public:
+        /**
+         * @param filters array of glob-style strings, ie: *.cpp / *.txt / *.{md,rst} / *.cpp;*.h / etc.
+         * <br/><b>Must be terminated with nullptr!</b>
+         */
+        explicit DirectoryModel(const char **filters = nullptr) {
+            settings.filters = filters;
+            settings.compile_filters();
+        }
+
+        ~DirectoryModel() {
+            delete context;
+        }
+
+        DirectoryModel(const DirectoryModel &)            = delete;
+        DirectoryModel &operator=(const DirectoryModel &) = delete;
+
+        /**
+         * Starts loading given directory (or directory of given file) in background,
+         * entries show up progressively on Update().
+         */
+        void Open(const char *path) {
+            const bool first = context == nullptr;
+            internal_::FileContext::load(&context, path, &settings);
+            if (first && filter_idx != 0)
+                Filter(filter_idx);
+        }
+
+        void Reload() {
+            if (context != nullptr)
+                internal_::FileContext::reload(&context);
+        }
+
+        /**
+         * Merges entries loaded in background and live changes of the directory, call it regularly.
+         * @return true if views changed
+         */
+        bool Update() {
+            return context != nullptr && internal_::FileContext::poll(context);
+        }
+
+        /**
+         * Blocks until current directory is completely loaded.
+         */
+        void Wait() {
+            while (Loading()) {
+                Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        bool Loading() const {
+            return context != nullptr && internal_::FileContext::loading(context);
+        }
+
+        const char *Path() const {
+            return context == nullptr ? nullptr : context->path->c_str();
+        }
+
+        bool Readable() const {
+            return context != nullptr && context->read;
+        }
+
+        bool Writable() const {
+            return context != nullptr && context->write;
+        }
+
+        /**
+         * @param filter_idx index into filters given to the constructor
+         */
+        void Filter(const int filter_idx) {
+            this->filter_idx = filter_idx;
+            if (context == nullptr || context->filter_idx == filter_idx)
+                return;
+            context->filter_idx = filter_idx;
+            internal_::FileContext::apply_filters(&context);
+        }
+
+        int Filter() const {
+            return filter_idx;
+        }
+
+        void FilterIgnoreCase(const bool enable) {
+            internal_::FileContext::set_icase(settings, &context, enable);
+        }
+
+        void ShowHiddenFiles(const bool enable) {
+            internal_::FileContext::set_hidden(settings, &context, enable);
+        }
+
+        void NaturalSort(const bool enable) {
+            internal_::FileContext::set_natural(settings, &context, enable);
+        }
+
+        void WatchDirectory(const bool enable) {
+            internal_::FileContext::set_watch(settings, &context, enable);
+        }
+
+        /**
+         * @param enable compute recursive totals of listed directories in background, see DirTotals()
+         */
+        void DirectorySizes(const bool enable) {
+            internal_::FileContext::set_dir_sizes(settings, &context, enable);
+        }
+
+        /**
+         * @param enable enumerate parent of current directory in background, so that going up is instant
+         */
+        void PrefetchListings(const bool enable) {
+            internal_::FileContext::set_prefetch(settings, enable);
+        }
+
+        void RecursiveListing(const bool enable, const int max_depth = 32) {
+            internal_::FileContext::set_recursive(settings, &context, enable, max_depth);
+        }
+
+        /**
+         * @param by SORT_NAME / SORT_SIZE / SORT_TYPE / SORT_TIME, or SORT_NONE for directory order
+         * @param order SORT_ASC or SORT_DSC
+         */
+        void Sort(const int by, const int order = SORT_ASC) {
+            if (context == nullptr)
+                return;
+            internal_::FileContext::sort(context, static_cast<char>(by), static_cast<char>(order));
+            if (by == SORT_NONE)
+                internal_::FileContext::refilter(context);
+        }
+
+        /**
+         * Narrows files down to names fuzzy-matching given query, best matches first.
+         * Empty query or nullptr ends the search.
+         */
+        void Search(const char *query) {
+            if (context != nullptr)
+                internal_::FileContext::search(context, query == nullptr ? "" : query);
+        }
+
+        std::size_t DirCount() const {
+            return context == nullptr ? 0 : context->dirs.size();
+        }
+
+        const char *DirName(const std::size_t index) const {
+            return context->listing.name_of(context->dirs[index]);
+        }
+
+        /**
+         * @return recursive totals of directory, nullptr until computed or if DirectorySizes() is off
+         */
+        const DirUsage *DirTotals(const std::size_t index) const {
+            const auto id = context->dirs[index];
+            const auto it = context->usage.find(std::string_view(context->listing.name_of(id), context->listing.length_of(id)));
+            return it == context->usage.end() ? nullptr : &it->second;
+        }
+
+        /**
+         * @return number of rows of files view, which all the per-file accessors below are indexed by
+         */
+        std::size_t FileCount() const {
+            return context == nullptr ? 0 : context->files.size();
+        }
+
+        const char *FileName(const std::size_t index) const {
+            return context->listing.name_of(context->files[index]);
+        }
+
+        const char *FileType(const std::size_t index) const {
+            return context->listing.type_of(context->files[index]);
+        }
+
+        std::uint64_t FileSize(const std::size_t index) const {
+            return context->listing.size[context->files[index]];
+        }
+
+        /**
+         * @return modification time in unix milliseconds
+         */
+        std::int64_t FileTime(const std::size_t index) const {
+            return context->listing.mtime[context->files[index]];
+        }
+
+        bool IsSelected(const std::size_t index) const {
+            return context->listing.selected(context->files[index]);
+        }
+
+        void Select(const std::size_t index) {
+            internal_::FileContext::select_single(context, static_cast<int>(index));
+        }
+
+        void Toggle(const std::size_t index) {
+            internal_::FileContext::select_toggle(context, static_cast<int>(index));
+        }
+
+        /**
+         * Selects every row between last selected or toggled one and given row.
+         * @param extend keep current selection instead of replacing it
+         */
+        void SelectRange(const std::size_t index, const bool extend = false) {
+            internal_::FileContext::select_range(context, static_cast<int>(index), extend);
+        }
+
+        void SelectAll() {
+            if (context != nullptr)
+                internal_::FileContext::select_all(context);
+        }
+
+        void InvertSelection() {
+            if (context != nullptr)
+                internal_::FileContext::select_invert(context);
+        }
+
+        void UnselectAll() {
+            if (context != nullptr)
+                internal_::FileContext::unselect_all(context);
+        }
+
+        /**
+         * Replaces selection with all visible files matching given glob, ie: *.png / img_??.{jpg,png}
+         * @return number of selected files
+         */
+        long SelectMatching(const char *glob) {
+            return context == nullptr ? 0 : std::max(0L, internal_::FileContext::select_matching(context, glob));
+        }
+
+        long CountSelected() const {
+            return context == nullptr ? 0 : static_cast<long>(context->selected.size());
+        }
+
+        /**
+         * @return timings and counters of the last load and operations, all zero unless compiled with SIMPFP_STATS
+         */
+        PhaseStats Stats() const {
+            return context == nullptr ? PhaseStats() : context->stats;
+        }
+
+        /**
+         * Streams absolute paths of selected files, in order of selection.
+         * @param callback receives every path (valid only during the call), returning false stops iteration
+         * @return number of reported paths
+         */
+        std::size_t ForEachSelected(const std::function<bool(const char *path)> &callback) const {
+            return context == nullptr ? 0 : internal_::FileContext::for_each_selected(context, callback);
+        }
+
+        /**
+         * Absolute paths of selected files in one batch, in order of selection.
+         * @return view valid until next call
+         */
+        PathSpan Selected() {
+            return context == nullptr ? PathSpan() : internal_::FileContext::collect(context, paths, views);
+        }
+
+    private:
+        internal_::Settings           settings;
+        internal_::FileContext       *context    = nullptr;
+        int                           filter_idx = 0;
+        std::string                   paths;
+        std::vector<std::string_view> views;
+    };
+
+    inline void ListingCacheCapacity(const std::size_t max_entries, const std::size_t max_bytes) {
+        internal_::listing_cache().resize(max_entries, max_bytes);
+    }
+
+    inline void PreviewCacheCapacity(const std::size_t max_bytes) {
+        internal_::preview_cache().resize(max_bytes);
+    }
+
+    inline CacheStats ListingCacheStats() {
+        const auto &cache = internal_::listing_cache();
+        CacheStats  stats;
+        stats.hits    = cache.hits;
+        stats.misses  = cache.misses;
+        stats.entries = cache.size();
+        stats.bytes   = cache.bytes;
+        return stats;
+    }
+
+} // namespace simpfp
+
+#endif // SIMPFP_CORE_H